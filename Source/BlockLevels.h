@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Range and sum of squares of the input and output signal and peak and sum of
+    squares of the gain reduction signal of one channel.
+*/
+struct ChannelLevels
+{
+    float inputMin;
+    float inputMax;
+    float inputSquares;
+    float outputMin;
+    float outputMax;
+    float outputSquares;
+    float reductionPeak;
+    float reductionSquares;
+};
+
+//==============================================================================
+/**
+    Levels of all channels over one block. They are accumulated by the kernels
+    while the samples are processed anyway, so the level meters and the
+    visualiser don't need to read or copy the buffers again.
+*/
+class BlockLevels
+{
+public:
+    /** Allocates space for the given number of channels, call from prepareToPlay. */
+    void prepare(int numChannels)
+    {
+        channels.resize(numChannels);
+        peaks.resize(numChannels);
+        rms.resize(numChannels);
+
+        meterSamples.resize((size_t) (numChannels * maxMeterLength));
+        meterChannels.resize(numChannels);
+        for (int channel = 0; channel < numChannels; ++channel)
+            meterChannels[channel] = meterSamples.data() + channel * maxMeterLength;
+
+        clear();
+    }
+
+    void clear()
+    {
+        std::fill(channels.begin(), channels.end(), ChannelLevels());
+    }
+
+    ChannelLevels& operator[](int channel) { return channels[channel]; }
+    int getNumChannels() const { return (int) channels.size(); }
+
+    /** Adds range and sum of squares of a chunk of samples. */
+    template <typename SampleType>
+    static void measure(const SampleType* data, int num, float& min, float& max, float& squares)
+    {
+        for (int i = 0; i < num; ++i) {
+            const float value = (float) data[i];
+            min = jmin(min, value);
+            max = jmax(max, value);
+            squares += value * value;
+        }
+    }
+
+    void pushToMeters(foleys::LevelMeterSource& input, foleys::LevelMeterSource& output,
+                      foleys::LevelMeterSource& reduction, int numSamples)
+    {
+        const int numChannels = getNumChannels();
+        const float inverseNumSamples = 1.0f / jmax(numSamples, 1);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            peaks[channel] = jmax(-channels[channel].inputMin, channels[channel].inputMax);
+            rms[channel] = std::sqrt(channels[channel].inputSquares * inverseNumSamples);
+        }
+        pushLevels(input, numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            peaks[channel] = jmax(-channels[channel].outputMin, channels[channel].outputMax);
+            rms[channel] = std::sqrt(channels[channel].outputSquares * inverseNumSamples);
+        }
+        pushLevels(output, numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            peaks[channel] = channels[channel].reductionPeak;
+            rms[channel] = std::sqrt(channels[channel].reductionSquares * inverseNumSamples);
+        }
+        pushLevels(reduction, numChannels);
+    }
+
+private:
+    enum { maxMeterLength = 1024 };
+
+    /**
+        Hands peaks and rms to a meter source. ff_meters only measures buffers, so
+        measureBlock() gets a short block with the same peak and RMS level: the peak
+        followed by N - 1 samples of sqrt((N * rms^2 - peak^2) / (N - 1)), with
+        N = (peak / rms)^2 rounded up. N is limited to maxMeterLength, so the RMS
+        level only reads high for peaks more than 30 dB above it.
+    */
+    void pushLevels(foleys::LevelMeterSource& source, int numChannels)
+    {
+        // The sources are resized in prepareToPlay, more channels would allocate in measureBlock()
+        numChannels = jmin(numChannels, source.getNumChannels());
+
+        int length = 1;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float peak = peaks[channel];
+            const float level = jmin(rms[channel], peak);
+
+            if (peak > 0.0f && peak * peak >= (float) maxMeterLength * level * level)
+                length = maxMeterLength;
+            else if (peak > 0.0f)
+                length = jmax(length, (int) std::ceil(peak * peak / (level * level)));
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float peak = peaks[channel];
+            const float level = jmin(rms[channel], peak);
+            const float rest = (length > 1) ? std::sqrt(jmax(0.0f, (length * level * level - peak * peak) / (length - 1)))
+                                            : 0.0f;
+
+            meterChannels[channel][0] = peak;
+            FloatVectorOperations::fill(meterChannels[channel] + 1, rest, length - 1);
+        }
+
+        source.measureBlock(AudioBuffer<float>(meterChannels.data(), numChannels, length));
+    }
+
+    std::vector<ChannelLevels> channels;
+    std::vector<float> peaks, rms;
+
+    // Blocks for the meter sources, maxMeterLength samples per channel
+    std::vector<float> meterSamples;
+    std::vector<float*> meterChannels;
+};
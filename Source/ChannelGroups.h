@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
+
+//==============================================================================
+/**
+    Assignment of the channels of a bus to link groups. The channels of a group
+    share one detector and envelope, the groups are compressed independently and
+    excluded channels pass unchanged. Groups are numbered from 0 in the order
+    their first channel appears.
+
+    Fixed size and without allocations, so it can be copied to the audio thread.
+*/
+class ChannelGroups
+{
+public:
+    enum {
+        maxChannels = 16,   // 7.1.4 plus a spare pair
+        excluded = -1
+    };
+
+    /** Common groupings of a layout, the LFE channels are excluded from all of them. */
+    enum Preset {
+        layoutPairs,    // the two channels of a left/right pair are linked, every other channel is independent
+        frontsLinked,   // the front channels with the centres are linked, the other pairs as in layoutPairs
+        allLinked,      // one group
+        independent     // one group per channel
+    };
+
+    /** No channels, until it is set every channel is excluded. */
+    ChannelGroups() = default;
+
+    /**
+        Groups of a layout after one of the presets, layoutPairs is the default.
+        A discrete layout has no pairs or fronts, all its channels are linked
+        unless they are independent.
+    */
+    static ChannelGroups fromLayout(const AudioChannelSet& layout, Preset preset = layoutPairs)
+    {
+        const int numChannels = jmin(layout.size(), (int) maxChannels);
+        int labels[maxChannels];
+
+        if (layout.isDiscreteLayout()) {
+            for (int channel = 0; channel < numChannels; ++channel)
+                labels[channel] = (preset == independent) ? channel : 0;
+            return ChannelGroups(labels, numChannels);
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const AudioChannelSet::ChannelType type = layout.getTypeOfChannel(channel);
+            const AudioChannelSet::ChannelType partner = getPairPartner(type);
+            const int partnerIndex = (partner != AudioChannelSet::unknown) ? layout.getChannelIndexForType(partner) : -1;
+
+            if (type == AudioChannelSet::LFE || type == AudioChannelSet::LFE2)
+                labels[channel] = excluded;
+            else if (preset == allLinked)
+                labels[channel] = 0;
+            else if (preset == independent)
+                labels[channel] = channel;
+            else if (preset == frontsLinked && isFront(type))
+                labels[channel] = maxChannels;  // a label no channel index uses
+            else if (partnerIndex >= 0 && partnerIndex < channel)
+                labels[channel] = labels[partnerIndex];
+            else
+                labels[channel] = channel;
+        }
+
+        return ChannelGroups(labels, numChannels);
+    }
+
+    /**
+        Parses a definition with one entry per channel, separated by spaces: any
+        label for the group of the channel or "x" if it is excluded. "1 1 2 x 3 3"
+        is 5.1 with linked fronts, an independent centre, no LFE and linked surrounds.
+        Returns false and leaves the groups alone if the definition isn't valid.
+    */
+    bool fromString(const String& definition)
+    {
+        StringArray tokens;
+        tokens.addTokens(definition, " ", "");
+        tokens.removeEmptyStrings();
+
+        if (tokens.isEmpty() || tokens.size() > maxChannels)
+            return false;
+
+        int labels[maxChannels];
+        for (int channel = 0; channel < tokens.size(); ++channel) {
+            const String& token = tokens[channel];
+            if (token.equalsIgnoreCase("x"))
+                labels[channel] = excluded;
+            else if (token.containsOnly("0123456789"))
+                labels[channel] = token.getIntValue();
+            else
+                return false;
+        }
+
+        *this = ChannelGroups(labels, tokens.size());
+        return true;
+    }
+
+    /** The definition in the format of fromString(), groups are numbered from 1. */
+    String toString() const
+    {
+        StringArray tokens;
+        for (int channel = 0; channel < numChannels; ++channel)
+            tokens.add(groups[channel] == excluded ? String("x") : String(groups[channel] + 1));
+
+        return tokens.joinIntoString(" ");
+    }
+
+    int getNumChannels() const { return numChannels; }
+    int getNumGroups() const { return numGroups; }
+
+    /** Group of the channel, excluded for channels beyond the definition. */
+    int getGroup(int channel) const { return (channel < numChannels) ? groups[channel] : (int) excluded; }
+
+    /** Weight of the channel in the mixdown of its group, 1 / the size of the group. */
+    float getChannelGain(int channel) const { return gains[channel]; }
+
+private:
+    /** Numbers the groups of the labels from 0 in the order they appear. */
+    ChannelGroups(const int* labels, int num)
+        : numChannels(num)
+    {
+        int labelOfGroup[maxChannels];
+        int size[maxChannels] = {};
+
+        for (int channel = 0; channel < num; ++channel) {
+            if (labels[channel] == excluded) {
+                groups[channel] = excluded;
+                continue;
+            }
+
+            const int* found = std::find(labelOfGroup, labelOfGroup + numGroups, labels[channel]);
+            const int group = (int) (found - labelOfGroup);
+            if (group == numGroups)
+                labelOfGroup[numGroups++] = labels[channel];
+
+            groups[channel] = group;
+            ++size[group];
+        }
+
+        for (int channel = 0; channel < num; ++channel)
+            gains[channel] = (groups[channel] == excluded) ? 0.0f : 1.0f / (float) size[groups[channel]];
+    }
+
+    /** The other channel of a left/right pair, unknown for channels that aren't part of one. */
+    static AudioChannelSet::ChannelType getPairPartner(AudioChannelSet::ChannelType type)
+    {
+        static const AudioChannelSet::ChannelType pairs[][2] = {
+            { AudioChannelSet::left, AudioChannelSet::right },
+            { AudioChannelSet::leftCentre, AudioChannelSet::rightCentre },
+            { AudioChannelSet::leftSurround, AudioChannelSet::rightSurround },
+            { AudioChannelSet::leftSurroundSide, AudioChannelSet::rightSurroundSide },
+            { AudioChannelSet::leftSurroundRear, AudioChannelSet::rightSurroundRear },
+            { AudioChannelSet::wideLeft, AudioChannelSet::wideRight },
+            { AudioChannelSet::topFrontLeft, AudioChannelSet::topFrontRight },
+            { AudioChannelSet::topRearLeft, AudioChannelSet::topRearRight }
+        };
+
+        for (const auto& pair : pairs) {
+            if (type == pair[0])
+                return pair[1];
+            if (type == pair[1])
+                return pair[0];
+        }
+
+        return AudioChannelSet::unknown;
+    }
+
+    /** The channels in front of the listener at ear height. */
+    static bool isFront(AudioChannelSet::ChannelType type)
+    {
+        return type == AudioChannelSet::left || type == AudioChannelSet::right || type == AudioChannelSet::centre
+            || type == AudioChannelSet::leftCentre || type == AudioChannelSet::rightCentre;
+    }
+
+    int numChannels = 0;
+    int numGroups = 0;
+    int groups[maxChannels] = {};
+    float gains[maxChannels] = {};
+};
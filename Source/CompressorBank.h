@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "CompressorCore.h"
+#include "FastMath.h"
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
+
+//==============================================================================
+/**
+    Any number of independent mono compressors with the same topology, for batch
+    processing outside of the plugin: peak detection in dB, the soft knee curve of
+    GainCurveTable and the branching attack/release smoother of the kernels.
+    Every compressor has its own parameters and envelope.
+
+    Parameters and envelopes are kept as structure of arrays, padded to whole lane
+    groups of numLanes compressors. The compressors of a lane group run through
+    every stage together, 16 of them per step in several SIMD registers. In the
+    envelope recursion the registers are independent and hide each other's
+    latency. So the cost grows with the number of lane groups instead of the
+    number of compressors. Lane groups share nothing and can be processed on
+    different threads.
+
+    Only depends on juce_core, juce_audio_basics and juce_dsp. Audio is passed as
+    planar float arrays, one per compressor. Only prepare() and setParameters()
+    compute anything expensive, process() doesn't allocate.
+*/
+class CompressorBank
+{
+public:
+    enum {
+        chunkSize = 64,
+        numLanes = 16   // compressors per lane group
+    };
+
+    /** Settings of one compressor, levels in dB and times in seconds. */
+    struct Parameters
+    {
+        float threshold = 0.0f;
+        float ratio = 1.0f;
+        float knee = 0.0f;
+        float attack = 0.002f;
+        float release = 0.3f;
+        float makeupGain = 0.0f;
+    };
+
+    /** Allocates numCompressors compressors with the default parameters, not real-time safe. */
+    void prepare(double newSampleRate, int numCompressors)
+    {
+        sampleRate = newSampleRate;
+        size = numCompressors;
+
+        const size_t paddedSize = (size_t) (getNumLaneGroups() * numLanes);
+        envelopes.assign(paddedSize, 0.0);
+        thresholds.assign(paddedSize, 0.0f);
+        slopes.assign(paddedSize, 0.0f);
+        halfKnees.assign(paddedSize, 0.0f);
+        halfInverseKnees.assign(paddedSize, 0.0f);
+        attackCoefficients.assign(paddedSize, 0.0f);
+        releaseCoefficients.assign(paddedSize, 0.0f);
+        makeupGains.assign(paddedSize, 0.0f);
+
+        for (int index = 0; index < numCompressors; ++index)
+            setParameters(index, Parameters());
+    }
+
+    /** Sets the parameters of one compressor, they apply from the next call to process(). */
+    void setParameters(int index, const Parameters& parameters)
+    {
+        jassert(index >= 0 && index < size);
+
+        thresholds[index] = parameters.threshold;
+        slopes[index] = 1.0f - 1.0f / parameters.ratio;
+        halfKnees[index] = 0.5f * parameters.knee;
+        halfInverseKnees[index] = (parameters.knee > 0.0f) ? 0.5f / parameters.knee : 0.0f;
+        attackCoefficients[index] = calculateCoefficient(parameters.attack);
+        releaseCoefficients[index] = calculateCoefficient(parameters.release);
+        makeupGains[index] = parameters.makeupGain;
+    }
+
+    /** Forgets the envelopes of all compressors. */
+    void reset() { std::fill(envelopes.begin(), envelopes.end(), 0.0); }
+
+    int getNumCompressors() const { return size; }
+
+    /** Number of groups of numLanes compressors. */
+    int getNumLaneGroups() const { return (size + numLanes - 1) / numLanes; }
+
+    /** Current smoothed gain reduction of one compressor in dB, positive while it reduces. */
+    float getGainReduction(int index) const { return (float) envelopes[(size_t) index]; }
+
+    /**
+        Compresses numSamples samples of every compressor, compressor c reads
+        inputs[c] and writes outputs[c]. Both may point to the same arrays.
+    */
+    void process(const float* const* inputs, float* const* outputs, int numSamples)
+    {
+        for (int laneGroup = 0; laneGroup < getNumLaneGroups(); ++laneGroup)
+            processLaneGroup(laneGroup, inputs, outputs, numSamples);
+    }
+
+    /** process() for the compressors of one lane group only. */
+    void processLaneGroup(int laneGroup, const float* const* inputs, float* const* outputs, int numSamples)
+    {
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        const int first = laneGroup * numLanes;
+        const int numActive = jmin((int) numLanes, size - first);
+
+        alignas(Lanes::SIMDRegisterSize) float lanes[chunkSize * numLanes];
+        float makeup[numLanes];
+
+        std::copy(&makeupGains[first], &makeupGains[first] + numLanes, makeup);
+        const GroupCoefficients coefficients{ &attackCoefficients[first], &releaseCoefficients[first] };
+
+        for (int start = 0; start < numSamples; start += chunkSize) {
+            const int num = jmin((int) chunkSize, numSamples - start);
+            const int frames = num * numLanes;
+
+            interleaveSquares(inputs + first, numActive, start, num, lanes);
+            MixDownDetector::levelFromPower(lanes, frames);
+            computeReduction(first, lanes, num);
+            BranchingSmoother::processLanes<numLanes>(&envelopes[(size_t) first], lanes, coefficients, num);
+
+            // 10 ^ ((makeupGain - yl) / 20) of every lane
+            for (int i = 0; i < num; ++i)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    lanes[i * numLanes + lane] = makeup[lane] - lanes[i * numLanes + lane];
+            FastMath::decibelsToGain(lanes, lanes, frames);
+
+            for (int lane = 0; lane < numActive; ++lane) {
+                const float* input = inputs[first + lane] + start;
+                float* output = outputs[first + lane] + start;
+                for (int i = 0; i < num; ++i)
+                    output[i] = input[i] * lanes[i * numLanes + lane];
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    /** Coefficients of one lane group for BranchingSmoother, one per lane and the same for every sample. */
+    struct GroupCoefficients
+    {
+        const float* attack(int) const { return alphaA; }
+        const float* release(int) const { return alphaR; }
+
+        const float* alphaA;
+        const float* alphaR;
+    };
+
+    /** Squares up to numLanes inputs into interleaved lanes, unused lanes are silent. */
+    static void interleaveSquares(const float* const* inputs, int numActive, int start, int num, float* lanes)
+    {
+        if (numActive < numLanes)
+            FloatVectorOperations::clear(lanes, num * numLanes);
+
+        for (int lane = 0; lane < numActive; ++lane) {
+            const float* data = inputs[lane] + start;
+            for (int i = 0; i < num; ++i)
+                lanes[i * numLanes + lane] = data[i] * data[i];
+        }
+    }
+
+    /**
+        GainCurveTable::computeReduction() for the levels in dB of one lane group,
+        in place and without branches:
+        (max(d - W / 2, 0) + clamp(d + W / 2, 0, W) ^ 2 / 2W) * (1 - 1 / R), d = xg - T.
+        The quadratic term is 0 for a hard knee.
+    */
+    void computeReduction(int first, float* lanes, int num) const
+    {
+        float threshold[numLanes], slope[numLanes], halfKnee[numLanes], halfInverseKnee[numLanes];
+
+        std::copy(&thresholds[first], &thresholds[first] + numLanes, threshold);
+        std::copy(&slopes[first], &slopes[first] + numLanes, slope);
+        std::copy(&halfKnees[first], &halfKnees[first] + numLanes, halfKnee);
+        std::copy(&halfInverseKnees[first], &halfInverseKnees[first] + numLanes, halfInverseKnee);
+
+        for (int i = 0; i < num; ++i) {
+            float* frame = lanes + i * numLanes;
+
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const float distance = frame[lane] - threshold[lane];
+                const float above = jmax(distance - halfKnee[lane], 0.0f);
+                const float inKnee = jmin(jmax(distance + halfKnee[lane], 0.0f), 2.0f * halfKnee[lane]);
+                frame[lane] = (above + inKnee * inKnee * halfInverseKnee[lane]) * slope[lane];
+            }
+        }
+    }
+
+    /** alpha = e ^ (-1 / (time * sampleRate)), 0 for a time constant of 0. */
+    float calculateCoefficient(float time) const
+    {
+        return (time == 0.0f) ? 0.0f : (float) std::exp(-1.0 / (time * sampleRate));
+    }
+
+    std::vector<double> envelopes;  // smoothed gain reduction in dB, in double like the kernels
+    double sampleRate = 44100.0;
+    int size = 0;
+
+    std::vector<float> thresholds, slopes, halfKnees, halfInverseKnees;
+    std::vector<float> attackCoefficients, releaseCoefficients, makeupGains;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompressorBank)
+};
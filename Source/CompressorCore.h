@@ -0,0 +1,600 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+    Uses code by Juan Gil <https://juangil.com/>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "ChannelGroups.h"
+#include "FastMath.h"
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
+
+//==============================================================================
+/**
+    Attack or release coefficient of the envelope follower.
+    The coefficient is only recomputed when the time constant or the sample rate
+    changes. A change is not applied instantly, instead the coefficient itself
+    is ramped to its new value, so the hot loop never has to call pow() / exp().
+*/
+class EnvelopeCoefficient
+{
+public:
+    void reset(double sampleRate, double rampLengthInSeconds)
+    {
+        inverseSampleRate = 1.0f / (float) sampleRate;
+        coefficient.reset(sampleRate, rampLengthInSeconds);
+        coefficient.setCurrentAndTargetValue(calculate(time));
+    }
+
+    /** Sets the time constant in seconds, starts a ramp if it changed. */
+    void setTime(float newTime)
+    {
+        if (newTime != time) {
+            time = newTime;
+            coefficient.setTargetValue(calculate(time));
+        }
+    }
+
+    bool isSmoothing() const { return coefficient.isSmoothing(); }
+    float getCurrentValue() const { return coefficient.getCurrentValue(); }
+    float getNextValue() { return coefficient.getNextValue(); }
+    float skip(int numSamples) { return coefficient.skip(numSamples); }
+
+    /** alpha = e ^ (-1 / (time * sampleRate)), 0 for a time constant of 0. */
+    float calculate(float value) const
+    {
+        return (value == 0.0f) ? 0.0f : std::exp(-inverseSampleRate / value);
+    }
+
+private:
+    LinearSmoothedValue<float> coefficient;
+    float time = 0.0f;
+    float inverseSampleRate = 1.0f / 44100.0f;
+};
+
+//==============================================================================
+/**
+    Mean of the last windowSize values of a signal, for frames of frameSize
+    interleaved values that are averaged separately.
+
+    A running sum keeps the cost per value constant whatever the window length.
+    A second sum collects the values of the current pass over the ring buffer,
+    when the pass completes it holds exactly the window and replaces the running
+    sum, so rounding errors can't accumulate. Both are kept in double, so they
+    don't drift within a pass either.
+*/
+class RmsWindow
+{
+public:
+    /** Allocates the ring buffer, call from prepareToPlay. */
+    void prepare(int maxWindowSize, int newFrameSize)
+    {
+        frameSize = newFrameSize;
+        ring.resize(jmax(maxWindowSize, 1) * frameSize);
+        sums.resize(frameSize);
+        freshSums.resize(frameSize);
+        setWindowSize(jlimit(1, jmax(maxWindowSize, 1), windowSize));
+    }
+
+    /** Sets the window length in frames and forgets all values, doesn't allocate. */
+    void setWindowSize(int newWindowSize)
+    {
+        jassert(newWindowSize > 0 && newWindowSize * frameSize <= (int) ring.size());
+
+        windowSize = newWindowSize;
+        inverseWindowSize = 1.0f / (float) windowSize;
+        position = 0;
+
+        std::fill(ring.begin(), ring.begin() + windowSize * frameSize, 0.0f);
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(freshSums.begin(), freshSums.end(), 0.0);
+    }
+
+    int getWindowSize() const { return windowSize; }
+
+    /** Replaces numFrames frames of squared levels by their means over the window, in place. */
+    void process(float* data, int numFrames)
+    {
+        for (int i = 0; i < numFrames; ++i) {
+            float* frame = data + i * frameSize;
+            float* oldest = &ring[position * frameSize];
+
+            for (int k = 0; k < frameSize; ++k) {
+                sums[k] += frame[k] - oldest[k];
+                freshSums[k] += frame[k];
+                oldest[k] = frame[k];
+                frame[k] = (float) jmax(sums[k], 0.0) * inverseWindowSize;
+            }
+
+            if (++position == windowSize) {
+                position = 0;
+                sums.swap(freshSums);
+                std::fill(freshSums.begin(), freshSums.end(), 0.0);
+            }
+        }
+    }
+
+private:
+    std::vector<float> ring;
+    std::vector<double> sums;       // running sum over the window
+    std::vector<double> freshSums;  // sum of the values of the current pass
+    int frameSize = 1, windowSize = 1, position = 0;
+    float inverseWindowSize = 1.0f;
+};
+
+//==============================================================================
+/**
+    Envelope state shared by all kernels, so switching kernels doesn't reset it.
+    The unlinked kernels keep one state per channel, allocated in whole groups of
+    numLanes channels, one channel per lane of a SIMD register.
+*/
+struct CompressorState
+{
+    enum { numLanes = (int) dsp::SIMDRegister<float>::SIMDNumElements };
+
+    /** Allocates the per channel state and the RMS windows, call from prepareToPlay. */
+    void prepare(int numChannels, int maxRmsWindowSize = 1)
+    {
+        const int size = (numChannels + numLanes - 1) / numLanes * numLanes;
+        channelYlPrev.resize(size);
+        channelLevelPrev.resize(size);
+        channelControlPrev.resize(size);
+        channelGateOpen.resize(size);
+
+        rmsWindow.prepare(maxRmsWindowSize, 1);
+        channelRmsWindows.resize(size / numLanes);
+        for (RmsWindow& window : channelRmsWindows)
+            window.prepare(maxRmsWindowSize, numLanes);
+
+        reset();
+    }
+
+    /** Sets the RMS window length in samples, the windows are cleared if it changed. */
+    void setRmsWindowSize(int windowSize)
+    {
+        if (windowSize == rmsWindow.getWindowSize())
+            return;
+
+        rmsWindow.setWindowSize(windowSize);
+        for (RmsWindow& window : channelRmsWindows)
+            window.setWindowSize(windowSize);
+    }
+
+    void reset()
+    {
+        ylPrev = 0.0;
+        levelPrev = 0.0;
+        controlPrev = 1.0f;
+        gateOpen = 0.0f;
+        linkAmountPrev = linkAmount;
+
+        std::fill(channelYlPrev.begin(), channelYlPrev.end(), 0.0);
+        std::fill(channelLevelPrev.begin(), channelLevelPrev.end(), 0.0);
+        std::fill(channelControlPrev.begin(), channelControlPrev.end(), 1.0f);
+        std::fill(channelGateOpen.begin(), channelGateOpen.end(), 0.0f);
+    }
+
+    // The envelopes are kept in double, so long release times don't accumulate rounding errors
+    double ylPrev = 0.0;        // smoothed gain reduction in dB
+    double levelPrev = 0.0;     // smoothed squared level, for detectors that smooth in the linear domain
+    float controlPrev = 1.0f;
+    float gateOpen = 0.0f;      // 1 while the gate is open, 0 while it is closed
+
+    std::vector<double> channelYlPrev, channelLevelPrev;
+    std::vector<float> channelControlPrev, channelGateOpen;
+
+    RmsWindow rmsWindow;                        // mean of the squared mixdown
+    std::vector<RmsWindow> channelRmsWindows;   // one per group of numLanes channels, one channel per lane
+
+    ChannelGroups channelGroups;                // link groups of the grouped kernel, one group per lane
+
+    // Share of the linked envelope in the partially linked kernel, set once per block and ramped from the previous one
+    float linkAmount = 0.0f, linkAmountPrev = 0.0f;
+};
+
+//==============================================================================
+/** Number of channels a kernel is specialised for, 0 stands for any number. */
+template <int NumChannels>
+struct ChannelCount
+{
+    static int get(int) { return NumChannels; }
+};
+
+template <>
+struct ChannelCount<0>
+{
+    static int get(int numChannels) { return numChannels; }
+};
+
+//==============================================================================
+/**
+    Channels the detector reads instead of the compressed ones, like an external
+    sidechain or its filtered copy. Sample i of a chunk is channels[c][start + i],
+    channels is nullptr if the detector reads the compressed channels.
+*/
+template <typename SampleType>
+struct DetectorInputOf
+{
+    const SampleType* const* channels;
+    int numChannels;
+    int start;
+};
+
+//==============================================================================
+/** Attack and release coefficients that stay the same for the whole chunk. */
+struct ConstantCoefficients
+{
+    float attack(int) const { return alphaA; }
+    float release(int) const { return alphaR; }
+
+    float alphaA, alphaR;
+};
+
+/** Attack and release coefficients that are ramping, one value per sample. */
+struct RampedCoefficients
+{
+    float attack(int i) const { return alphaA[i]; }
+    float release(int i) const { return alphaR[i]; }
+
+    const float* alphaA;
+    const float* alphaR;
+};
+
+/** Attack and release coefficients with one value per lane of a SIMD register, for the whole chunk. */
+struct LaneCoefficients
+{
+    dsp::SIMDRegister<float> attack(int) const { return alphaA; }
+    dsp::SIMDRegister<float> release(int) const { return alphaR; }
+
+    dsp::SIMDRegister<float> alphaA, alphaR;
+};
+
+//==============================================================================
+/**
+    Detector policy: mono mixdown of all channels, squared. The level stays in the
+    linear domain, the envelope is smoothed before it is converted to dB.
+*/
+struct LinearMixDownDetector
+{
+    enum { linearDomain = 1 };
+
+    template <int NumChannels, typename SampleType>
+    static void process(CompressorState&, const SampleType* const* input, int numChannels, int start, int num,
+                        float* level)
+    {
+        mixDown(input, ChannelCount<NumChannels>::get(numChannels), start, num, level);
+        FloatVectorOperations::multiply(level, level, num);
+    }
+
+    /**
+        Mean of n channels, the level is float whatever the sample type.
+        Wide layouts are summed four channels per pass over the chunk, so the
+        sum is loaded and stored once for every four channels and each pass is
+        a plain vectorisable loop over the samples.
+    */
+    template <typename SampleType>
+    static void mixDown(const SampleType* const* input, int n, int start, int num, float* level)
+    {
+        enum { blockSize = 64 };
+
+        for (int blockStart = 0; blockStart < num; blockStart += blockSize) {
+            const int blockNum = jmin((int) blockSize, num - blockStart);
+            SampleType sum[blockSize];
+
+            const int first = start + blockStart;
+            int channel = n % 4;
+            sumChannels(input, channel, first, blockNum, sum);
+
+            for (; channel < n; channel += 4) {
+                const SampleType* a = input[channel] + first;
+                const SampleType* b = input[channel + 1] + first;
+                const SampleType* c = input[channel + 2] + first;
+                const SampleType* d = input[channel + 3] + first;
+
+                for (int i = 0; i < blockNum; ++i)
+                    sum[i] += (a[i] + b[i]) + (c[i] + d[i]);
+            }
+
+            const SampleType channelGain = (SampleType) 1 / (SampleType) n;
+            for (int i = 0; i < blockNum; ++i)
+                level[blockStart + i] = (float) (sum[i] * channelGain);
+        }
+    }
+
+    /** Sum of the first n channels, 0 to 3 of them. */
+    template <typename SampleType>
+    static void sumChannels(const SampleType* const* input, int n, int start, int num, SampleType* sum)
+    {
+        for (int i = 0; i < num; ++i) {
+            SampleType value = 0;
+            for (int channel = 0; channel < n; ++channel)
+                value += input[channel][start + i];
+            sum[i] = value;
+        }
+    }
+
+    /** Averages interleaved squared levels of the unlinked kernels, nothing to do here. */
+    static void windowLanes(CompressorState&, int, float*, int) {}
+
+    /** Turns squared levels into the detector's domain, nothing to do here. */
+    static void levelFromPower(float*, int) {}
+};
+
+/**
+    Detector policy: mono mixdown of all channels, squared and converted to dB
+    (10 * log10 since the level is squared) with a floor of -60 dB.
+*/
+struct MixDownDetector
+{
+    enum { linearDomain = 0 };
+
+    template <int NumChannels, typename SampleType>
+    static void process(CompressorState& state, const SampleType* const* input, int numChannels, int start, int num,
+                        float* level)
+    {
+        LinearMixDownDetector::process<NumChannels>(state, input, numChannels, start, num, level);
+        levelFromPower(level, num);
+    }
+
+    static void windowLanes(CompressorState&, int, float*, int) {}
+
+    /** Turns squared levels into the detector's domain. */
+    static void levelFromPower(float* level, int num)
+    {
+        FloatVectorOperations::max(level, level, 1e-6f, num);
+        FastMath::powerToDecibels(level, level, num);
+    }
+};
+
+/**
+    Detector policy: the squared mixdown averaged over the RMS window of the
+    state, then turned into the domain of the Detector it is based on.
+*/
+template <typename Detector>
+struct RmsDetector
+{
+    enum { linearDomain = Detector::linearDomain };
+
+    template <int NumChannels, typename SampleType>
+    static void process(CompressorState& state, const SampleType* const* input, int numChannels, int start, int num,
+                        float* level)
+    {
+        LinearMixDownDetector::process<NumChannels>(state, input, numChannels, start, num, level);
+        state.rmsWindow.process(level, num);
+        Detector::levelFromPower(level, num);
+    }
+
+    /** Averages the interleaved squared levels of the group of channels starting at first. */
+    static void windowLanes(CompressorState& state, int first, float* lanes, int num)
+    {
+        state.channelRmsWindows[first / CompressorState::numLanes].process(lanes, num);
+    }
+
+    static void levelFromPower(float* level, int num)
+    {
+        Detector::levelFromPower(level, num);
+    }
+};
+
+//==============================================================================
+/** Gain computer policy: hard knee curve, returns xg - yg = max(xg - T, 0) * (1 - 1 / R). */
+struct HardKneeCurve
+{
+    void process(float* data, int num) const
+    {
+        FloatVectorOperations::add(data, -threshold, num);
+        FloatVectorOperations::max(data, data, 0.0f, num);
+        FloatVectorOperations::multiply(data, 1.0f - 1.0f / ratio, num);
+    }
+
+    /** Interleaved lanes of the unlinked kernels, starting at channel first. */
+    void processLanes(float* lanes, int numFrames, int /*first*/) const
+    {
+        process(lanes, numFrames * CompressorState::numLanes);
+    }
+
+    /** Input level in dB up to which the reduction is 0. */
+    float getLowerLimit() const { return threshold; }
+
+    float threshold;
+    float ratio;
+};
+
+//==============================================================================
+/**
+    Gain computer policy: the reduction of Curve plus a gate with its own
+    threshold, evaluated on the same detected level in the same pass.
+    The gate opens as soon as the level rises above threshold and only closes
+    again once it falls below threshold - hysteresis, so a level hovering around
+    the threshold doesn't make it chatter. While closed it adds range dB to the
+    reduction, the envelope of the compressor turns the steps into fades.
+
+    The open/closed state lives in the CompressorState: open points to the state
+    of the linked kernel, laneOpen to the per channel states of the unlinked lanes.
+*/
+template <typename Curve>
+struct GatedCurve
+{
+    enum {
+        numLanes = CompressorState::numLanes,
+        maxSize = 64 * numLanes
+    };
+
+    void process(float* data, int num) const
+    {
+        float gate[maxSize];
+
+        processGate(data, num, 1, open, gate);
+        curve.process(data, num);
+        FloatVectorOperations::add(data, gate, num);
+    }
+
+    void processLanes(float* lanes, int numFrames, int first) const
+    {
+        float gate[maxSize];
+
+        processGate(lanes, numFrames, numLanes, laneOpen + first, gate);
+        curve.processLanes(lanes, numFrames, first);
+        FloatVectorOperations::add(lanes, gate, numFrames * numLanes);
+    }
+
+    /** A closed gate reduces any level, so there is none. */
+    float getLowerLimit() const { return -std::numeric_limits<float>::infinity(); }
+
+    /**
+        Runs the hysteresis of numStates interleaved gates over numFrames levels
+        in dB and writes the reduction of the gate to gate.
+    */
+    void processGate(const float* levels, int numFrames, int numStates, float* states, float* gate) const
+    {
+        jassert(numFrames * numStates <= maxSize && numStates <= numLanes);
+
+        const float closeThreshold = threshold - hysteresis;
+        float isOpen[numLanes];
+        std::copy(states, states + numStates, isOpen);
+
+        for (int i = 0; i < numFrames; ++i) {
+            for (int s = 0; s < numStates; ++s) {
+                const float level = levels[i * numStates + s];
+                isOpen[s] = level > (isOpen[s] > 0.0f ? closeThreshold : threshold) ? 1.0f : 0.0f;
+                gate[i * numStates + s] = (1.0f - isOpen[s]) * range;
+            }
+        }
+
+        std::copy(isOpen, isOpen + numStates, states);
+    }
+
+    Curve curve;
+    float threshold;    // dB
+    float range;        // dB of reduction while closed
+    float hysteresis;   // dB below threshold before it closes again
+    float* open;
+    float* laneOpen;
+};
+
+//==============================================================================
+/**
+    Smoother policy: one pole filter that switches between attack and release.
+    The recursion runs in double, only the smoothed values it writes are float.
+*/
+struct BranchingSmoother
+{
+    template <typename Coefficients>
+    static void process(double& ylPrev, float* data, const Coefficients& coefficients, int num)
+    {
+        double yl = ylPrev;
+
+        for (int i = 0; i < num; ++i) {
+            const double xl = data[i];
+            const double alpha = (xl > yl) ? coefficients.attack(i) : coefficients.release(i);
+            yl = alpha * yl + (1.0 - alpha) * xl;
+            data[i] = (float) yl;
+        }
+
+        ylPrev = yl;
+    }
+
+    /**
+        The same filter for interleaved signals, one channel per lane, so all lanes
+        run through the recursion in the same instructions. A double register holds
+        half of the float lanes of a float register, so every frame of
+        CompressorState::numLanes lanes takes two of them. With more lanes the
+        independent registers also hide the latency of the recursion.
+        ylPrev and data hold NumLanes values per sample.
+    */
+    template <int NumLanes = CompressorState::numLanes, typename Coefficients>
+    static void processLanes(double* ylPrev, float* data, const Coefficients& coefficients, int num)
+    {
+        typedef dsp::SIMDRegister<double> Lanes;
+
+        enum {
+            numLanes = NumLanes,
+            numRegisters = numLanes / (int) Lanes::SIMDNumElements
+        };
+        static_assert(numLanes % (int) Lanes::SIMDNumElements == 0, "whole double registers per frame");
+
+        alignas(Lanes::SIMDRegisterSize) double xl[numLanes], alphaA[numLanes], alphaR[numLanes];
+        Lanes yl[numRegisters];
+
+        std::copy(ylPrev, ylPrev + numLanes, xl);
+        for (int r = 0; r < numRegisters; ++r)
+            yl[r] = Lanes::fromRawArray(xl + r * (int) Lanes::size());
+
+        const Lanes one = Lanes::expand(1.0);
+
+        for (int i = 0; i < num; ++i) {
+            float* frame = data + i * numLanes;
+            toDoubles<numLanes>(frame, xl);
+            toDoubles<numLanes>(coefficients.attack(i), alphaA);
+            toDoubles<numLanes>(coefficients.release(i), alphaR);
+
+            for (int r = 0; r < numRegisters; ++r) {
+                const int offset = r * (int) Lanes::size();
+                const Lanes x = Lanes::fromRawArray(xl + offset);
+
+                const auto rising = Lanes::greaterThan(x, yl[r]);
+                const Lanes alpha = (Lanes::fromRawArray(alphaA + offset) & rising)
+                                  + (Lanes::fromRawArray(alphaR + offset) & ~rising);
+
+                yl[r] = alpha * yl[r] + (one - alpha) * x;
+                yl[r].copyToRawArray(xl + offset);
+            }
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                frame[lane] = (float) xl[lane];
+        }
+
+        for (int r = 0; r < numRegisters; ++r)
+            yl[r].copyToRawArray(xl + r * (int) Lanes::size());
+        std::copy(xl, xl + numLanes, ylPrev);
+    }
+
+    /** Widens one frame of NumLanes lanes, coefficients are either the same for all lanes or one per lane. */
+    template <int NumLanes>
+    static void toDoubles(const float* values, double* lanes)
+    {
+        for (int lane = 0; lane < NumLanes; ++lane)
+            lanes[lane] = values[lane];
+    }
+
+    template <int NumLanes>
+    static void toDoubles(float value, double* lanes)
+    {
+        std::fill(lanes, lanes + NumLanes, (double) value);
+    }
+
+    template <int NumLanes>
+    static void toDoubles(dsp::SIMDRegister<float> values, double* lanes)
+    {
+        static_assert(NumLanes == (int) dsp::SIMDRegister<float>::SIMDNumElements, "one float register per frame");
+
+        for (int lane = 0; lane < NumLanes; ++lane)
+            lanes[lane] = values.get((size_t) lane);
+    }
+};
@@ -0,0 +1,897 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+    Uses code by Juan Gil <https://juangil.com/>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "BlockLevels.h"
+#include "CompressorCore.h"
+
+//==============================================================================
+/** Adds one sample before and after compression and its gain reduction to the levels. */
+inline void accumulateLevels(ChannelLevels& l, float oldValue, float newValue, float reductionValue)
+{
+    l.inputMin = jmin(l.inputMin, oldValue);
+    l.inputMax = jmax(l.inputMax, oldValue);
+    l.inputSquares += oldValue * oldValue;
+    l.outputMin = jmin(l.outputMin, newValue);
+    l.outputMax = jmax(l.outputMax, newValue);
+    l.outputSquares += newValue * newValue;
+    l.reductionPeak = jmax(l.reductionPeak, std::abs(reductionValue));
+    l.reductionSquares += reductionValue * reductionValue;
+}
+
+/**
+    Applies the control gain to one channel and accumulates its input, output and
+    gain reduction levels. The control gain of sample i is control[i * ControlStride].
+    The samples keep their precision, only the levels for the meters are float.
+
+    This loop runs once per channel, so it sets the cost of wide layouts. The levels
+    are accumulated in numPartials independent minima, maxima and sums that are only
+    folded together at the end: without a dependency from one sample to the next,
+    the compiler can vectorise the loop without fast math.
+*/
+template <int ControlStride, typename SampleType>
+void applyControlToChannel(SampleType* data, const float* control, int num, ChannelLevels& levels)
+{
+    enum { numPartials = 8 };
+
+    float inputMin[numPartials], inputMax[numPartials], inputSquares[numPartials];
+    float outputMin[numPartials], outputMax[numPartials], outputSquares[numPartials];
+    float reductionPeak[numPartials], reductionSquares[numPartials];
+
+    for (int k = 0; k < numPartials; ++k) {
+        inputMin[k] = levels.inputMin;
+        inputMax[k] = levels.inputMax;
+        outputMin[k] = levels.outputMin;
+        outputMax[k] = levels.outputMax;
+        reductionPeak[k] = levels.reductionPeak;
+        inputSquares[k] = outputSquares[k] = reductionSquares[k] = 0.0f;
+    }
+
+    const int numVectorised = num - num % numPartials;
+
+    for (int i = 0; i < numVectorised; i += numPartials) {
+        // All loads come before the stores, the data may not alias the control
+        SampleType samples[numPartials];
+        float gains[numPartials];
+        for (int k = 0; k < numPartials; ++k) {
+            samples[k] = data[i + k];
+            gains[k] = control[(i + k) * ControlStride];
+        }
+
+        for (int k = 0; k < numPartials; ++k) {
+            const SampleType output = samples[k] * (SampleType) gains[k];
+            const float oldValue = (float) samples[k];
+            const float newValue = (float) output;
+            // oldValue - newValue while reducing, written without a branch the vectoriser can't convert
+            const float reductionValue = oldValue * jmax(1.0f - gains[k], 0.0f);
+
+            samples[k] = output;
+            inputMin[k] = jmin(inputMin[k], oldValue);
+            inputMax[k] = jmax(inputMax[k], oldValue);
+            inputSquares[k] += oldValue * oldValue;
+            outputMin[k] = jmin(outputMin[k], newValue);
+            outputMax[k] = jmax(outputMax[k], newValue);
+            outputSquares[k] += newValue * newValue;
+            reductionPeak[k] = jmax(reductionPeak[k], std::abs(reductionValue));
+            reductionSquares[k] += reductionValue * reductionValue;
+        }
+
+        std::copy(samples, samples + numPartials, data + i);
+    }
+
+    ChannelLevels l = levels;
+
+    for (int k = 0; k < numPartials; ++k) {
+        l.inputMin = jmin(l.inputMin, inputMin[k]);
+        l.inputMax = jmax(l.inputMax, inputMax[k]);
+        l.inputSquares += inputSquares[k];
+        l.outputMin = jmin(l.outputMin, outputMin[k]);
+        l.outputMax = jmax(l.outputMax, outputMax[k]);
+        l.outputSquares += outputSquares[k];
+        l.reductionPeak = jmax(l.reductionPeak, reductionPeak[k]);
+        l.reductionSquares += reductionSquares[k];
+    }
+
+    for (int i = numVectorised; i < num; ++i) {
+        const float gain = control[i * ControlStride];
+        const SampleType output = data[i] * (SampleType) gain;
+        const float oldValue = (float) data[i];
+        const float newValue = (float) output;
+
+        data[i] = output;
+        accumulateLevels(l, oldValue, newValue, (gain < 1.0f) ? oldValue - newValue : 0.0f);
+    }
+
+    levels = l;
+}
+
+//==============================================================================
+/**
+    Block oriented compressor kernel, composed at compile time of a Detector,
+    a GainComputer and a Smoother policy and specialised for a number of
+    channels (0 for any number).
+    Every stage runs over a whole chunk of samples at a time, either through
+    FloatVectorOperations or in plain loops without any dependencies between
+    iterations, so the compiler can vectorise them. Only the envelope is a
+    recursion and stays sequential. Chunks are at most chunkSize samples long,
+    so the scratch data stays in L1 cache between the stages.
+*/
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+struct CompressorKernel
+{
+    enum { chunkSize = 64 };
+
+    typedef GainComputer GainComputerType;
+
+    /**
+        Runs the detector over one chunk. It reads the detector input if there is
+        one and the compressed channels otherwise, straight from the read pointers
+        either way.
+    */
+    template <typename SampleType>
+    static void detect(CompressorState& state, const SampleType* const* channels, int numChannels,
+                       const DetectorInputOf<SampleType>& detectorInput, int start, int num, float* level)
+    {
+        if (detectorInput.channels != nullptr)
+            Detector::template process<0>(state, detectorInput.channels, detectorInput.numChannels,
+                                          detectorInput.start, num, level);
+        else
+            Detector::template process<NumChannels>(state, channels, numChannels, start, num, level);
+    }
+
+    /**
+        Turns the detector levels of one chunk into the control gain, in place.
+        With a control interval above 1 the gain is only computed at the end
+        of every interval and interpolated in between. In the dB domain the
+        curve and the envelope still run per sample, since the attack/release
+        branch has to follow the instantaneous level (ControlRateTests measures
+        the error of the interpolation).
+
+        A detector in the dB domain smooths the gain reduction, a detector in the
+        linear domain smooths the squared level instead. The level is then only
+        converted to dB where it is needed: at the end of the intervals, and
+        not at all for chunks that stay below the curve.
+    */
+    template <typename Coefficients>
+    static void computeControl(CompressorState& state, const GainComputer& gainComputer, const Coefficients& coefficients,
+                               float makeupGain, int controlInterval, int num, float* control)
+    {
+        jassert(num <= chunkSize);
+
+        float reductions[chunkSize];
+
+        if (Detector::linearDomain) {
+            Smoother::process(state.levelPrev, control, coefficients, num);
+
+            if (controlInterval > 1) {
+                const int numIntervals = sampleIntervalEnds(control, controlInterval, num, reductions);
+                levelToReduction(gainComputer, reductions, numIntervals);
+                interpolateGain(state, reductions, makeupGain, controlInterval, num, control);
+            }
+            else if (levelToReduction(gainComputer, control, num)) {
+                decibelsToGain(control, makeupGain, num);
+                state.controlPrev = control[num - 1];
+            }
+            else {
+                state.controlPrev = FastMath::exp2(makeupGain * 0.166096405f); // log2(10) / 20
+                FloatVectorOperations::fill(control, state.controlPrev, num);
+            }
+        }
+        else {
+            gainComputer.process(control, num);
+            Smoother::process(state.ylPrev, control, coefficients, num);
+
+            if (controlInterval > 1) {
+                sampleIntervalEnds(control, controlInterval, num, reductions);
+                interpolateGain(state, reductions, makeupGain, controlInterval, num, control);
+            }
+            else {
+                decibelsToGain(control, makeupGain, num);
+                state.controlPrev = control[num - 1];
+            }
+        }
+    }
+
+    /**
+        Applies the control gain to all channels in a single pass over the chunk.
+        While the samples are in L1 cache the input, output and gain reduction
+        levels are accumulated, nothing else is written.
+    */
+    template <typename SampleType>
+    static void applyControl(SampleType* const* channels, int numChannels, int start, int num, const float* control,
+                             BlockLevels& levels)
+    {
+        const int n = ChannelCount<NumChannels>::get(numChannels);
+
+        for (int channel = 0; channel < n; ++channel)
+            applyControlToChannel<1>(channels[channel] + start, control, num, levels[channel]);
+    }
+
+    /** Compresses one chunk of all channels in place. */
+    template <typename SampleType, typename Coefficients>
+    static void processChunk(CompressorState& state, SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                             const GainComputer& gainComputer, const Coefficients& coefficients,
+                             float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        float control[chunkSize];
+
+        detect(state, channels, numChannels, detectorInput, start, num, control);
+        computeControl(state, gainComputer, coefficients, makeupGain, controlInterval, num, control);
+        applyControl(channels, numChannels, start, num, control, levels);
+    }
+
+    /** All channels share the envelope, so there is a single lane group. */
+    static int getNumLaneGroups(const CompressorState&, int) { return 1; }
+
+    template <typename SampleType, typename Coefficients>
+    static void processLaneGroup(int, CompressorState& state, SampleType* const* channels, int numChannels,
+                                 const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                                 const GainComputer& gainComputer, const Coefficients& coefficients,
+                                 float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        processChunk(state, channels, numChannels, detectorInput, start, num, gainComputer, coefficients,
+                     makeupGain, controlInterval, levels);
+    }
+
+    //==============================================================================
+
+    /** 10 ^ ((makeupGain - yl) / 20). */
+    static void decibelsToGain(float* data, float makeupGain, int num)
+    {
+        FloatVectorOperations::negate(data, data, num);
+        FloatVectorOperations::add(data, makeupGain, num);
+        FastMath::decibelsToGain(data, data, num);
+    }
+
+    /**
+        Converts smoothed squared levels to the gain reduction of the curve in place.
+        Returns false without touching the data if the whole chunk stays below
+        the curve, so quiet passages don't need a single logarithm.
+    */
+    static bool levelToReduction(const GainComputer& gainComputer, float* data, int num)
+    {
+        if (staysBelowCurve(gainComputer, data, num))
+            return false;
+
+        powerToDecibels(data, num);
+        gainComputer.process(data, num);
+        return true;
+    }
+
+    /**
+        Returns true and fills the data with 0 dB of reduction if all squared
+        levels stay below the lower limit of the curve. A curve without a lower
+        limit, like a gate, never does.
+    */
+    static bool staysBelowCurve(const GainComputer& gainComputer, float* data, int num)
+    {
+        const float lowerLimitDb = gainComputer.getLowerLimit();
+        if (lowerLimitDb == -std::numeric_limits<float>::infinity())
+            return false;
+
+        const float lowerLimit = FastMath::exp2(lowerLimitDb * 0.332192809f); // log2(10) / 10
+        if (FloatVectorOperations::findMaximum(data, num) > lowerLimit)
+            return false;
+
+        FloatVectorOperations::fill(data, 0.0f, num);
+        return true;
+    }
+
+    /** Squared levels to dB in place, clamped at -60 dB. */
+    static void powerToDecibels(float* data, int num)
+    {
+        FloatVectorOperations::max(data, data, 1e-6f, num);
+        FastMath::powerToDecibels(data, data, num);
+    }
+
+    /** Copies the value at the end of every interval to ends, returns the number of intervals. */
+    static int sampleIntervalEnds(const float* data, int interval, int num, float* ends)
+    {
+        int numIntervals = 0;
+        for (int start = 0; start < num; start += interval)
+            ends[numIntervals++] = data[jmin(start + interval, num) - 1];
+
+        return numIntervals;
+    }
+
+    /**
+        Control rate version of the dB to gain conversion.
+        The gain reduction at the end of every interval is converted to a gain,
+        the control gain is interpolated linearly in between.
+    */
+    static void interpolateGain(CompressorState& state, const float* reductions, float makeupGain,
+                                int interval, int num, float* control)
+    {
+        for (int start = 0, k = 0; start < num; start += interval, ++k) {
+            const int length = jmin(interval, num - start);
+            float* segment = control + start;
+
+            const float target = FastMath::exp2((makeupGain - reductions[k]) * 0.166096405f); // log2(10) / 20
+            const float step = (target - state.controlPrev) / (float) length;
+
+            for (int i = 0; i < length; ++i)
+                segment[i] = state.controlPrev + step * (float) (i + 1);
+
+            state.controlPrev = target;
+        }
+    }
+};
+
+//==============================================================================
+/**
+    Unlinked version of CompressorKernel: every channel has its own detector,
+    envelope and control gain, there is no mixdown.
+    The channels are processed in groups of CompressorState::numLanes. The squared
+    samples of a group are interleaved into the lanes of SIMD registers, so every
+    stage, including the envelope recursion, handles all channels of the group in
+    the same instructions and a group costs about as much as a single channel.
+*/
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+struct UnlinkedCompressorKernel
+{
+    enum {
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes
+    };
+
+    typedef CompressorKernel<Detector, GainComputer, Smoother, NumChannels> LinkedKernel;
+    typedef GainComputer GainComputerType;
+
+    /**
+        Compresses one chunk of all channels in place. With a detector input,
+        channel c is keyed by its channel c modulo the number of its channels,
+        so a mono sidechain keys all of them.
+    */
+    template <typename SampleType, typename Coefficients>
+    static void processChunk(CompressorState& state, SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                             const GainComputer& gainComputer, const Coefficients& coefficients,
+                             float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        const int numLaneGroups = getNumLaneGroups(state, numChannels);
+
+        for (int laneGroup = 0; laneGroup < numLaneGroups; ++laneGroup)
+            processLaneGroup(laneGroup, state, channels, numChannels, detectorInput, start, num,
+                             gainComputer, coefficients, makeupGain, controlInterval, levels);
+    }
+
+    /** Number of groups of numLanes channels, they share no state and can run on different threads. */
+    static int getNumLaneGroups(const CompressorState&, int numChannels)
+    {
+        return (ChannelCount<NumChannels>::get(numChannels) + numLanes - 1) / numLanes;
+    }
+
+    /** Compresses one chunk of the channels of one lane group in place. */
+    template <typename SampleType, typename Coefficients>
+    static void processLaneGroup(int laneGroup, CompressorState& state, SampleType* const* channels, int numChannels,
+                                 const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                                 const GainComputer& gainComputer, const Coefficients& coefficients,
+                                 float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        const int n = ChannelCount<NumChannels>::get(numChannels);
+        const int first = laneGroup * numLanes;
+        const int numActive = jmin((int) numLanes, n - first);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float control[chunkSize * numLanes];
+        const SampleType* detectorChannels[numLanes];
+        const bool external = detectorInput.channels != nullptr;
+        const int detectorStart = external ? detectorInput.start : start;
+
+        for (int lane = 0; lane < numActive; ++lane)
+            detectorChannels[lane] = external ? detectorInput.channels[(first + lane) % detectorInput.numChannels]
+                                              : channels[first + lane];
+
+        interleaveSquares(detectorChannels, numActive, detectorStart, num, control);
+        Detector::windowLanes(state, first, control, num);
+        computeControl(state, first, gainComputer, coefficients, makeupGain, controlInterval, num, control);
+
+        for (int lane = 0; lane < numActive; ++lane)
+            applyControlToChannel<numLanes>(channels[first + lane] + start, control + lane, num, levels[first + lane]);
+    }
+
+    //==============================================================================
+
+    /** Squares up to numLanes channels into interleaved lanes, unused lanes are silent. */
+    template <typename SampleType>
+    static void interleaveSquares(const SampleType* const* channels, int numActive, int start, int num, float* lanes)
+    {
+        if (numActive < numLanes)
+            FloatVectorOperations::clear(lanes, num * numLanes);
+
+        for (int lane = 0; lane < numActive; ++lane) {
+            const SampleType* data = channels[lane] + start;
+            for (int i = 0; i < num; ++i)
+                lanes[i * numLanes + lane] = (float) (data[i] * data[i]);
+        }
+    }
+
+    /** Turns the interleaved squared levels of one group into interleaved control gains. */
+    template <typename Coefficients>
+    static void computeControl(CompressorState& state, int first, const GainComputer& gainComputer,
+                               const Coefficients& coefficients, float makeupGain, int controlInterval,
+                               int num, float* lanes)
+    {
+        computeReduction(state, first, gainComputer, coefficients, num, lanes);
+        reductionToControl(state, first, makeupGain, controlInterval, num, lanes);
+    }
+
+    /** Turns the interleaved squared levels of one group into their smoothed gain reductions in dB. */
+    template <typename Coefficients>
+    static void computeReduction(CompressorState& state, int first, const GainComputer& gainComputer,
+                                 const Coefficients& coefficients, int num, float* lanes)
+    {
+        const int size = num * numLanes;
+
+        if (Detector::linearDomain) {
+            Smoother::processLanes(&state.channelLevelPrev[first], lanes, coefficients, num);
+            if (!LinkedKernel::staysBelowCurve(gainComputer, lanes, size)) {
+                LinkedKernel::powerToDecibels(lanes, size);
+                gainComputer.processLanes(lanes, num, first);
+            }
+        }
+        else {
+            Detector::levelFromPower(lanes, size);
+            gainComputer.processLanes(lanes, num, first);
+            Smoother::processLanes(&state.channelYlPrev[first], lanes, coefficients, num);
+        }
+    }
+
+    /** Turns the interleaved gain reductions of one group into control gains, with the makeup gain. */
+    static void reductionToControl(CompressorState& state, int first, float makeupGain, int controlInterval,
+                                   int num, float* lanes)
+    {
+        const int size = num * numLanes;
+        float* controlPrev = &state.channelControlPrev[first];
+
+        if (controlInterval > 1) {
+            interpolateGain(controlPrev, lanes, makeupGain, controlInterval, num);
+        }
+        else {
+            LinkedKernel::decibelsToGain(lanes, makeupGain, size);
+            std::copy(lanes + size - numLanes, lanes + size, controlPrev);
+        }
+    }
+
+    /** Control rate dB to gain conversion of interleaved lanes, in place. */
+    static void interpolateGain(float* controlPrev, float* lanes, float makeupGain, int interval, int num)
+    {
+        for (int start = 0; start < num; start += interval) {
+            const int length = jmin(interval, num - start);
+            float* segment = lanes + start * numLanes;
+            float target[numLanes], step[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane) {
+                target[lane] = FastMath::exp2((makeupGain - segment[(length - 1) * numLanes + lane]) * 0.166096405f); // log2(10) / 20
+                step[lane] = (target[lane] - controlPrev[lane]) / (float) length;
+            }
+
+            for (int i = 0; i < length; ++i)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    segment[i * numLanes + lane] = controlPrev[lane] + step[lane] * (float) (i + 1);
+
+            std::copy(target, target + numLanes, controlPrev);
+        }
+    }
+};
+
+//==============================================================================
+/**
+    Compressor kernel between unlinked and linked: every channel has its own
+    envelope like in the unlinked kernel, and all of them share a linked envelope
+    of the loudest channel. The gain reduction of a channel is the blend
+    (1 - linkAmount) * own + linkAmount * linked in dB, with the link amount of
+    the state ramped over the chunk.
+
+    The linked level is the maximum of the channel levels instead of their mean,
+    so content that is out of phase between the channels can't cancel in it. It
+    is taken lane by lane from the interleaved levels of the unlinked detector in
+    the same pass, so every link amount costs the same: the unlinked lanes plus a
+    single envelope. That envelope couples all channels, so there is one lane group.
+    While the amount is 0 the linked envelope isn't needed, it starts again from
+    the loudest channel envelope when the amount rises.
+*/
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+struct PartiallyLinkedCompressorKernel
+{
+    enum {
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes,
+        maxLaneGroups = (ChannelGroups::maxChannels + numLanes - 1) / numLanes
+    };
+
+    typedef UnlinkedCompressorKernel<Detector, GainComputer, Smoother, NumChannels> LaneKernel;
+    typedef CompressorKernel<Detector, GainComputer, Smoother, NumChannels> LinkedKernel;
+    typedef GainComputer GainComputerType;
+
+    /** Compresses one chunk of all channels in place, the detector input is mapped like in the unlinked kernel. */
+    template <typename SampleType, typename Coefficients>
+    static void processChunk(CompressorState& state, SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                             const GainComputer& gainComputer, const Coefficients& coefficients,
+                             float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        const int n = ChannelCount<NumChannels>::get(numChannels);
+        const int numLaneGroups = (n + numLanes - 1) / numLanes;
+        const int size = num * numLanes;
+        jassert(numLaneGroups <= maxLaneGroups);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float control[maxLaneGroups][chunkSize * numLanes];
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float loudest[chunkSize * numLanes];
+        float linked[chunkSize], amounts[chunkSize];
+
+        const SampleType* detectorChannels[numLanes];
+        const bool external = detectorInput.channels != nullptr;
+        const int detectorStart = external ? detectorInput.start : start;
+
+        // The linked envelope stood still while the amount was 0, it starts from the loudest channel instead
+        if (state.linkAmountPrev == 0.0f && n > 0)
+            syncLinkedEnvelope(state, n);
+
+        // Levels of all groups, their lane wise maximum on the way. Unused lanes are silent
+        for (int laneGroup = 0; laneGroup < numLaneGroups; ++laneGroup) {
+            const int first = laneGroup * numLanes;
+            const int numActive = jmin((int) numLanes, n - first);
+            float* lanes = control[laneGroup];
+
+            for (int lane = 0; lane < numActive; ++lane)
+                detectorChannels[lane] = external ? detectorInput.channels[(first + lane) % detectorInput.numChannels]
+                                                  : channels[first + lane];
+
+            LaneKernel::interleaveSquares(detectorChannels, numActive, detectorStart, num, lanes);
+            Detector::windowLanes(state, first, lanes, num);
+
+            if (laneGroup == 0)
+                std::copy(lanes, lanes + size, loudest);
+            else
+                FloatVectorOperations::max(loudest, loudest, lanes, size);
+        }
+
+        for (int i = 0; i < num; ++i)
+            linked[i] = *std::max_element(loudest + i * numLanes, loudest + (i + 1) * numLanes);
+
+        computeLinkedReduction(state, gainComputer, coefficients, num, linked);
+
+        const float step = (state.linkAmount - state.linkAmountPrev) / (float) num;
+        for (int i = 0; i < num; ++i)
+            amounts[i] = state.linkAmountPrev + step * (float) (i + 1);
+        state.linkAmountPrev = state.linkAmount;
+
+        for (int laneGroup = 0; laneGroup < numLaneGroups; ++laneGroup) {
+            const int first = laneGroup * numLanes;
+            const int numActive = jmin((int) numLanes, n - first);
+            float* lanes = control[laneGroup];
+
+            LaneKernel::computeReduction(state, first, gainComputer, coefficients, num, lanes);
+
+            for (int i = 0; i < num; ++i)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    lanes[i * numLanes + lane] += amounts[i] * (linked[i] - lanes[i * numLanes + lane]);
+
+            LaneKernel::reductionToControl(state, first, makeupGain, controlInterval, num, lanes);
+
+            for (int lane = 0; lane < numActive; ++lane)
+                applyControlToChannel<numLanes>(channels[first + lane] + start, lanes + lane, num, levels[first + lane]);
+        }
+    }
+
+    /** The linked envelope couples all channels, so there is a single lane group. */
+    static int getNumLaneGroups(const CompressorState&, int) { return 1; }
+
+    template <typename SampleType, typename Coefficients>
+    static void processLaneGroup(int, CompressorState& state, SampleType* const* channels, int numChannels,
+                                 const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                                 const GainComputer& gainComputer, const Coefficients& coefficients,
+                                 float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        processChunk(state, channels, numChannels, detectorInput, start, num, gainComputer, coefficients,
+                     makeupGain, controlInterval, levels);
+    }
+
+    //==============================================================================
+
+    /** Sets the linked envelope to the maximum of the envelopes of the first numChannels channels. */
+    static void syncLinkedEnvelope(CompressorState& state, int numChannels)
+    {
+        state.ylPrev = *std::max_element(state.channelYlPrev.begin(), state.channelYlPrev.begin() + numChannels);
+        state.levelPrev = *std::max_element(state.channelLevelPrev.begin(), state.channelLevelPrev.begin() + numChannels);
+    }
+
+    /** Smoothed gain reduction in dB of the loudest channel, in the envelope of the linked kernel. */
+    template <typename Coefficients>
+    static void computeLinkedReduction(CompressorState& state, const GainComputer& gainComputer,
+                                       const Coefficients& coefficients, int num, float* level)
+    {
+        if (Detector::linearDomain) {
+            Smoother::process(state.levelPrev, level, coefficients, num);
+            LinkedKernel::levelToReduction(gainComputer, level, num);
+        }
+        else {
+            Detector::levelFromPower(level, num);
+            gainComputer.process(level, num);
+            Smoother::process(state.ylPrev, level, coefficients, num);
+        }
+    }
+};
+
+//==============================================================================
+/**
+    Compressor kernel for link groups: the channels of a group share one detector
+    and envelope, the groups are compressed independently and excluded channels
+    pass unchanged. Every group takes one lane of the unlinked kernel, the mixdown
+    of its channels is accumulated straight into the interleaved lanes, so there
+    is no mixdown buffer and up to numLanes groups cost about as much as one.
+*/
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+struct GroupedCompressorKernel
+{
+    enum {
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes
+    };
+
+    typedef UnlinkedCompressorKernel<Detector, GainComputer, Smoother, NumChannels> LaneKernel;
+    typedef GainComputer GainComputerType;
+
+    /**
+        Compresses one chunk of all channels in place, with the groups of
+        state.channelGroups. With a detector input, channel c is keyed by its
+        channel c modulo the number of its channels, as in the unlinked kernel.
+    */
+    template <typename SampleType, typename Coefficients>
+    static void processChunk(CompressorState& state, SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                             const GainComputer& gainComputer, const Coefficients& coefficients,
+                             float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        const int numLaneGroups = getNumLaneGroups(state, numChannels);
+
+        for (int laneGroup = 0; laneGroup < numLaneGroups; ++laneGroup)
+            processLaneGroup(laneGroup, state, channels, numChannels, detectorInput, start, num,
+                             gainComputer, coefficients, makeupGain, controlInterval, levels);
+    }
+
+    /**
+        Number of groups of numLanes link groups, they share no state and can run
+        on different threads. There is always one, it also meters the excluded channels.
+    */
+    static int getNumLaneGroups(const CompressorState& state, int)
+    {
+        return jmax(1, (state.channelGroups.getNumGroups() + numLanes - 1) / numLanes);
+    }
+
+    /** Compresses one chunk of the channels of one lane group in place. */
+    template <typename SampleType, typename Coefficients>
+    static void processLaneGroup(int laneGroup, CompressorState& state, SampleType* const* channels, int numChannels,
+                                 const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                                 const GainComputer& gainComputer, const Coefficients& coefficients,
+                                 float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        const ChannelGroups& groups = state.channelGroups;
+        const int n = ChannelCount<NumChannels>::get(numChannels);
+        const int first = laneGroup * numLanes;
+
+        if (first < groups.getNumGroups()) {
+            alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float control[chunkSize * numLanes];
+
+            const bool external = detectorInput.channels != nullptr;
+            const SampleType* const* detectorChannels = external ? detectorInput.channels : channels;
+            const int numDetectorChannels = external ? detectorInput.numChannels : n;
+            const int detectorStart = external ? detectorInput.start : start;
+
+            mixDownGroups(groups, first, n, detectorChannels, numDetectorChannels, detectorStart, num, control);
+            Detector::windowLanes(state, first, control, num);
+            LaneKernel::computeControl(state, first, gainComputer, coefficients, makeupGain, controlInterval,
+                                       num, control);
+
+            for (int channel = 0; channel < n; ++channel) {
+                const int lane = groups.getGroup(channel) - first;   // negative for excluded channels
+                if (lane >= 0 && lane < numLanes)
+                    applyControlToChannel<numLanes>(channels[channel] + start, control + lane, num, levels[channel]);
+            }
+        }
+
+        // Excluded channels are only metered
+        if (laneGroup == 0) {
+            for (int channel = 0; channel < n; ++channel) {
+                if (groups.getGroup(channel) == ChannelGroups::excluded) {
+                    ChannelLevels& l = levels[channel];
+                    BlockLevels::measure(channels[channel] + start, num, l.inputMin, l.inputMax, l.inputSquares);
+                    BlockLevels::measure(channels[channel] + start, num, l.outputMin, l.outputMax, l.outputSquares);
+                }
+            }
+        }
+    }
+
+    /**
+        Squared mixdown of the groups first to first + numLanes - 1 into interleaved
+        lanes, each channel weighted by 1 / the size of its group. Lanes without a
+        group stay silent.
+    */
+    template <typename SampleType>
+    static void mixDownGroups(const ChannelGroups& groups, int first, int numChannels,
+                              const SampleType* const* detectorChannels, int numDetectorChannels,
+                              int start, int num, float* lanes)
+    {
+        FloatVectorOperations::clear(lanes, num * numLanes);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const int lane = groups.getGroup(channel) - first;
+            if (lane < 0 || lane >= numLanes)
+                continue;
+
+            const SampleType* data = detectorChannels[channel % numDetectorChannels] + start;
+            const SampleType gain = (SampleType) groups.getChannelGain(channel);
+            for (int i = 0; i < num; ++i)
+                lanes[i * numLanes + lane] += (float) (data[i] * gain);
+        }
+
+        FloatVectorOperations::multiply(lanes, lanes, num * numLanes);
+    }
+};
+
+//==============================================================================
+/**
+    Mid/side version of the compressor kernels for a stereo pair. Mid and side
+    get their own detector and envelope in two lanes of UnlinkedCompressorKernel,
+    linked they both get the larger gain reduction of the two.
+
+    Mid and side are never written to a buffer: they are encoded while the
+    detector reads the samples and decoded while the gain is applied, so the
+    mid/side matrix costs no pass over the chunk of its own.
+*/
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels, bool Linked>
+struct MidSideKernel
+{
+    enum {
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes,
+        midLane = 0,
+        sideLane = 1
+    };
+
+    typedef UnlinkedCompressorKernel<Detector, GainComputer, Smoother, NumChannels> LaneKernel;
+    typedef GainComputer GainComputerType;
+
+    /**
+        Compresses one chunk of both channels in place. A stereo detector input
+        is encoded to mid/side as well, a mono one keys both.
+    */
+    template <typename SampleType, typename Coefficients>
+    static void processChunk(CompressorState& state, SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                             const GainComputer& gainComputer, const Coefficients& coefficients,
+                             float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize && numChannels == 2);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float control[chunkSize * numLanes];
+        const bool external = detectorInput.channels != nullptr;
+
+        if (external)
+            interleaveMidSideSquares(detectorInput.channels, detectorInput.numChannels, detectorInput.start, num, control);
+        else
+            interleaveMidSideSquares(channels, numChannels, start, num, control);
+
+        Detector::windowLanes(state, 0, control, num);
+        LaneKernel::computeControl(state, 0, gainComputer, coefficients, makeupGain, controlInterval, num, control);
+
+        if (Linked) {
+            for (int i = 0; i < num; ++i) {
+                float* frame = control + i * numLanes;
+                frame[midLane] = frame[sideLane] = jmin(frame[midLane], frame[sideLane]);
+            }
+        }
+
+        applyMidSide(channels[0] + start, channels[1] + start, control, num, levels[0], levels[1]);
+    }
+
+    /** Mid and side share one lane group. */
+    static int getNumLaneGroups(const CompressorState&, int) { return 1; }
+
+    template <typename SampleType, typename Coefficients>
+    static void processLaneGroup(int, CompressorState& state, SampleType* const* channels, int numChannels,
+                                 const DetectorInputOf<SampleType>& detectorInput, int start, int num,
+                                 const GainComputer& gainComputer, const Coefficients& coefficients,
+                                 float makeupGain, int controlInterval, BlockLevels& levels)
+    {
+        processChunk(state, channels, numChannels, detectorInput, start, num, gainComputer, coefficients,
+                     makeupGain, controlInterval, levels);
+    }
+
+    //==============================================================================
+
+    /** Squares of mid and side in their lanes, the other lanes are silent. */
+    template <typename SampleType>
+    static void interleaveMidSideSquares(const SampleType* const* channels, int numChannels, int start, int num,
+                                         float* lanes)
+    {
+        FloatVectorOperations::clear(lanes, num * numLanes);
+
+        if (numChannels < 2) {
+            const SampleType* data = channels[0] + start;
+            for (int i = 0; i < num; ++i)
+                lanes[i * numLanes + midLane] = lanes[i * numLanes + sideLane] = (float) (data[i] * data[i]);
+            return;
+        }
+
+        const SampleType* left = channels[0] + start;
+        const SampleType* right = channels[1] + start;
+
+        for (int i = 0; i < num; ++i) {
+            const SampleType mid = (left[i] + right[i]) * (SampleType) 0.5;
+            const SampleType side = (left[i] - right[i]) * (SampleType) 0.5;
+            lanes[i * numLanes + midLane] = (float) (mid * mid);
+            lanes[i * numLanes + sideLane] = (float) (side * side);
+        }
+    }
+
+    /**
+        Encodes, applies the mid and side gains and decodes in a single pass,
+        the levels are accumulated for left and right.
+    */
+    template <typename SampleType>
+    static void applyMidSide(SampleType* left, SampleType* right, const float* control, int num,
+                             ChannelLevels& leftLevels, ChannelLevels& rightLevels)
+    {
+        ChannelLevels l = leftLevels, r = rightLevels;
+
+        for (int i = 0; i < num; ++i) {
+            const float midGain = control[i * numLanes + midLane];
+            const float sideGain = control[i * numLanes + sideLane];
+            const bool reducing = midGain < 1.0f || sideGain < 1.0f;
+
+            const SampleType mid = (left[i] + right[i]) * (SampleType) (0.5f * midGain);
+            const SampleType side = (left[i] - right[i]) * (SampleType) (0.5f * sideGain);
+            const float oldLeft = (float) left[i], oldRight = (float) right[i];
+
+            left[i] = mid + side;
+            right[i] = mid - side;
+
+            const float newLeft = (float) left[i], newRight = (float) right[i];
+            accumulateLevels(l, oldLeft, newLeft, reducing ? oldLeft - newLeft : 0.0f);
+            accumulateLevels(r, oldRight, newRight, reducing ? oldRight - newRight : 0.0f);
+        }
+
+        leftLevels = l;
+        rightLevels = r;
+    }
+};
+
+/** Mid and side with the same gain, the larger reduction of the two. */
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+using MidSideCompressorKernel = MidSideKernel<Detector, GainComputer, Smoother, NumChannels, true>;
+
+/** Mid and side compressed independently. */
+template <typename Detector, typename GainComputer, typename Smoother, int NumChannels>
+using UnlinkedMidSideCompressorKernel = MidSideKernel<Detector, GainComputer, Smoother, NumChannels, false>;
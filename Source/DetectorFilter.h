@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "CompressorKernel.h"
+
+//==============================================================================
+/** Biquad coefficients normalised to a0 = 1, designed after the RBJ audio EQ cookbook. */
+struct BiquadCoefficients
+{
+    /** Second order Butterworth high pass. */
+    static BiquadCoefficients highPass(double sampleRate, double frequency)
+    {
+        const double w0 = MathConstants<double>::twoPi * frequency / sampleRate;
+        const double cosW0 = std::cos(w0);
+        const double alpha = std::sin(w0) / MathConstants<double>::sqrt2; // sin(w0) / (2 * Q), Q = 1 / sqrt(2)
+
+        const double a0 = 1.0 + alpha;
+        const double b = (1.0 + cosW0) / (2.0 * a0);
+
+        return { (float) b, (float) (-2.0 * b), (float) b,
+                 (float) (-2.0 * cosW0 / a0), (float) ((1.0 - alpha) / a0) };
+    }
+
+    /** Second order Butterworth low pass. */
+    static BiquadCoefficients lowPass(double sampleRate, double frequency)
+    {
+        const double w0 = MathConstants<double>::twoPi * frequency / sampleRate;
+        const double cosW0 = std::cos(w0);
+        const double alpha = std::sin(w0) / MathConstants<double>::sqrt2; // sin(w0) / (2 * Q), Q = 1 / sqrt(2)
+
+        const double a0 = 1.0 + alpha;
+        const double b = (1.0 - cosW0) / (2.0 * a0);
+
+        return { (float) b, (float) (2.0 * b), (float) b,
+                 (float) (-2.0 * cosW0 / a0), (float) ((1.0 - alpha) / a0) };
+    }
+
+    /**
+        Second order allpass with the poles of the Butterworth filters, the sum
+        of the Linkwitz-Riley low and high pass at the same frequency.
+    */
+    static BiquadCoefficients allPass(double sampleRate, double frequency)
+    {
+        const BiquadCoefficients c = lowPass(sampleRate, frequency);
+        return { c.a2, c.a1, 1.0f, c.a1, c.a2 };
+    }
+
+    /**
+        Tilt around the given frequency: a high shelf with the gain split
+        between both sides, -gain / 2 dB at DC and +gain / 2 dB at Nyquist.
+    */
+    static BiquadCoefficients tilt(double sampleRate, double frequency, double gainDb)
+    {
+        const double A = std::pow(10.0, gainDb / 40.0);
+        const double w0 = MathConstants<double>::twoPi * frequency / sampleRate;
+        const double cosW0 = std::cos(w0);
+        const double twoSqrtAAlpha = std::sin(w0) * std::sqrt(2.0 * A); // shelf slope 1
+
+        const double a0 = (A + 1.0) - (A - 1.0) * cosW0 + twoSqrtAAlpha;
+
+        // The shelf alone goes from 0 dB to gain, 1 / A moves it to -gain / 2 ... +gain / 2
+        return { (float) (((A + 1.0) + (A - 1.0) * cosW0 + twoSqrtAAlpha) / a0),
+                 (float) (-2.0 * ((A - 1.0) + (A + 1.0) * cosW0) / a0),
+                 (float) (((A + 1.0) + (A - 1.0) * cosW0 - twoSqrtAAlpha) / a0),
+                 (float) (2.0 * ((A - 1.0) - (A + 1.0) * cosW0) / a0),
+                 (float) (((A + 1.0) - (A - 1.0) * cosW0 - twoSqrtAAlpha) / a0) };
+    }
+
+    float b0, b1, b2, a1, a2;
+};
+
+//==============================================================================
+/** Biquad in transposed direct form II. */
+struct Biquad
+{
+    /**
+        Filters interleaved signals in place, one channel per lane of a SIMD
+        register. state holds s1 and s2 of every lane, lanes has to be aligned.
+    */
+    static void processLanes(const BiquadCoefficients& c, float* state, float* lanes, int num)
+    {
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        alignas(Lanes::SIMDRegisterSize) float previous[2 * Lanes::SIMDNumElements];
+        std::copy(state, state + 2 * Lanes::size(), previous);
+
+        Lanes s1 = Lanes::fromRawArray(previous);
+        Lanes s2 = Lanes::fromRawArray(previous + Lanes::size());
+        const Lanes b0 = Lanes::expand(c.b0), b1 = Lanes::expand(c.b1), b2 = Lanes::expand(c.b2);
+        const Lanes a1 = Lanes::expand(c.a1), a2 = Lanes::expand(c.a2);
+
+        for (int i = 0; i < num; ++i) {
+            float* frame = lanes + i * (int) Lanes::size();
+            const Lanes x = Lanes::fromRawArray(frame);
+
+            const Lanes y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+
+            y.copyToRawArray(frame);
+        }
+
+        s1.copyToRawArray(previous);
+        s2.copyToRawArray(previous + Lanes::size());
+        std::copy(previous, previous + 2 * Lanes::size(), state);
+    }
+};
+
+//==============================================================================
+/**
+    Filter stage in front of the detector: a high pass, so low frequencies like
+    kick drums don't pump the compressor, and an optional tilt.
+
+    Both are biquads in transposed direct form II. The channels are interleaved
+    into the lanes of SIMD registers like in UnlinkedCompressorKernel, so a group
+    of channels runs through the recursion in the same instructions. The filtered
+    chunk is written to a scratch buffer the detector reads from, the compressed
+    signal itself is never filtered.
+*/
+class DetectorFilter
+{
+public:
+    enum {
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes
+    };
+
+    static constexpr float highPassOff = 20.0f;     // a high pass at the lowest frequency is off
+    static constexpr float tiltFrequency = 1000.0f;
+
+    /** Allocates the scratch buffer and filter states, call from prepareToPlay. */
+    void prepare(double newSampleRate, int numChannels)
+    {
+        const int numGroups = (numChannels + numLanes - 1) / numLanes;
+
+        output.setSize(jmax(numChannels, 1), chunkSize);
+        doubleOutput.setSize(jmax(numChannels, 1), chunkSize);
+        highPassState.resize(numGroups * 2 * numLanes);
+        tiltState.resize(numGroups * 2 * numLanes);
+        setSampleRate(newSampleRate);
+    }
+
+    /** Clears the filter states and recomputes the coefficients for a new rate, doesn't allocate. */
+    void setSampleRate(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        std::fill(highPassState.begin(), highPassState.end(), 0.0f);
+        std::fill(tiltState.begin(), tiltState.end(), 0.0f);
+
+        // Forces new coefficients with the next parameters
+        highPassFrequency = -1.0f;
+        tiltGain = -1.0f;
+    }
+
+    /**
+        Recomputes the coefficients, only if a parameter changed. A high pass at
+        highPassOff and a tilt of 0 dB are off and cost nothing.
+    */
+    void setParameters(float newHighPassFrequency, float newTiltGain)
+    {
+        if (newHighPassFrequency != highPassFrequency) {
+            highPassFrequency = newHighPassFrequency;
+            highPassActive = highPassFrequency > highPassOff;
+            if (highPassActive)
+                highPass = BiquadCoefficients::highPass(sampleRate, highPassFrequency);
+        }
+
+        if (newTiltGain != tiltGain) {
+            tiltGain = newTiltGain;
+            tiltActive = tiltGain != 0.0f;
+            if (tiltActive)
+                tilt = BiquadCoefficients::tilt(sampleRate, tiltFrequency, tiltGain);
+        }
+    }
+
+    bool isActive() const { return highPassActive || tiltActive; }
+
+    /**
+        Filters one chunk of the given channels into the scratch buffer of their
+        sample type and returns it as the detector input, its chunk starts at sample 0.
+    */
+    template <typename SampleType>
+    DetectorInputOf<SampleType> process(const SampleType* const* input, int numChannels, int start, int num)
+    {
+        AudioBuffer<SampleType>& output = getOutput(SampleType());
+        jassert(num <= chunkSize && numChannels <= output.getNumChannels());
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float lanes[chunkSize * numLanes];
+
+        for (int first = 0, group = 0; first < numChannels; first += numLanes, ++group) {
+            const int numActive = jmin((int) numLanes, numChannels - first);
+
+            if (numActive < numLanes)
+                FloatVectorOperations::clear(lanes, num * numLanes);
+
+            for (int lane = 0; lane < numActive; ++lane) {
+                const SampleType* data = input[first + lane] + start;
+                for (int i = 0; i < num; ++i)
+                    lanes[i * numLanes + lane] = (float) data[i];
+            }
+
+            if (highPassActive)
+                Biquad::processLanes(highPass, &highPassState[group * 2 * numLanes], lanes, num);
+            if (tiltActive)
+                Biquad::processLanes(tilt, &tiltState[group * 2 * numLanes], lanes, num);
+
+            for (int lane = 0; lane < numActive; ++lane) {
+                SampleType* data = output.getWritePointer(first + lane);
+                for (int i = 0; i < num; ++i)
+                    data[i] = lanes[i * numLanes + lane];
+            }
+        }
+
+        return { output.getArrayOfReadPointers(), numChannels, 0 };
+    }
+
+private:
+    AudioBuffer<float>& getOutput(float) { return output; }
+    AudioBuffer<double>& getOutput(double) { return doubleOutput; }
+
+    AudioBuffer<float> output;
+    AudioBuffer<double> doubleOutput;
+    std::vector<float> highPassState, tiltState;
+
+    BiquadCoefficients highPass = {}, tilt = {};
+    bool highPassActive = false, tiltActive = false;
+
+    double sampleRate = 44100.0;
+    float highPassFrequency = -1.0f, tiltGain = -1.0f;
+};
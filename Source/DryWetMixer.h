@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BlockLevels.h"
+
+//==============================================================================
+/**
+    Blends the dry input back into the compressed signal for parallel compression.
+
+    The dry samples of every block are written to a ring buffer before the block
+    is compressed and read back delayed by the latency of the wet path, so both
+    stay aligned when the limiter or the oversampling filters delay the signal.
+    The ring holds the longest latency plus one block and is only allocated in
+    prepare(), the crossfade is done in place in the output buffer.
+*/
+template <typename SampleType>
+class DryWetMixer
+{
+public:
+    enum { chunkSize = 64 };
+
+    /** Allocates the ring buffer for delays up to maxDelay and blocks up to maxBlockSize. */
+    void prepare(int numChannels, int maxDelay, int maxBlockSize)
+    {
+        ring.setSize(jmax(numChannels, 1), maxDelay + jmax(maxBlockSize, 1));
+        ring.clear();
+        position = blockStart = 0;
+    }
+
+    void release()
+    {
+        ring.setSize(0, 0);
+    }
+
+    bool isPrepared() const { return ring.getNumSamples() > 0; }
+
+    /** Stores the dry samples of a block, call before the block is processed. */
+    void pushDry(const SampleType* const* channels, int numChannels, int num)
+    {
+        jassert(num <= ring.getNumSamples() && numChannels <= ring.getNumChannels());
+
+        const int size = ring.getNumSamples();
+        const int size1 = jmin(num, size - position);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            SampleType* line = ring.getWritePointer(channel);
+            FloatVectorOperations::copy(line + position, channels[channel], size1);
+            FloatVectorOperations::copy(line, channels[channel] + size1, num - size1);
+        }
+
+        blockStart = position;
+        position = (position + num) % size;
+    }
+
+    /**
+        Crossfades the processed block with the dry block delayed by delay samples,
+        out = dry + mix * (wet - dry). The output levels are measured again in the
+        same pass, their sum of squares scaled by squaresScale to match the number
+        of samples the kernels counted.
+    */
+    void mix(SampleType* const* channels, int numChannels, int num, int delay,
+             LinearSmoothedValue<float>& mixValue, BlockLevels& levels, float squaresScale)
+    {
+        const int size = ring.getNumSamples();
+        jassert(delay + num <= size);
+
+        float mixes[chunkSize];
+        int readStart = (blockStart - delay + size) % size;
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            ChannelLevels& l = levels[channel];
+            l.outputMin = l.outputMax = l.outputSquares = 0.0f;
+        }
+
+        for (int start = 0; start < num; start += chunkSize) {
+            const int length = jmin((int) chunkSize, num - start);
+
+            if (mixValue.isSmoothing()) {
+                for (int i = 0; i < length; ++i)
+                    mixes[i] = mixValue.getNextValue();
+            }
+            else {
+                FloatVectorOperations::fill(mixes, mixValue.getNextValue(), length);
+            }
+
+            // The chunk of the ring wraps at most once
+            const int length1 = jmin(length, size - readStart);
+
+            for (int channel = 0; channel < numChannels; ++channel) {
+                SampleType* data = channels[channel] + start;
+                const SampleType* line = ring.getReadPointer(channel);
+                ChannelLevels& l = levels[channel];
+
+                crossfade(data, line + readStart, mixes, length1, l);
+                crossfade(data + length1, line, mixes + length1, length - length1, l);
+            }
+
+            readStart = (readStart + length) % size;
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            levels[channel].outputSquares *= squaresScale;
+    }
+
+    /** Replaces the block with the dry block delayed by delay samples, for bypass. */
+    void readDry(SampleType* const* channels, int numChannels, int num, int delay) const
+    {
+        const int size = ring.getNumSamples();
+        jassert(delay + num <= size);
+
+        const int readStart = (blockStart - delay + size) % size;
+        const int num1 = jmin(num, size - readStart);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const SampleType* line = ring.getReadPointer(channel);
+            FloatVectorOperations::copy(channels[channel], line + readStart, num1);
+            FloatVectorOperations::copy(channels[channel] + num1, line, num - num1);
+        }
+    }
+
+private:
+    static void crossfade(SampleType* data, const SampleType* dry, const float* mixes, int num, ChannelLevels& l)
+    {
+        float min = l.outputMin, max = l.outputMax, squares = l.outputSquares;
+
+        for (int i = 0; i < num; ++i) {
+            data[i] = dry[i] + (SampleType) mixes[i] * (data[i] - dry[i]);
+
+            const float value = (float) data[i];
+            min = jmin(min, value);
+            max = jmax(max, value);
+            squares += value * value;
+        }
+
+        l.outputMin = min;
+        l.outputMax = max;
+        l.outputSquares = squares;
+    }
+
+    AudioBuffer<SampleType> ring;
+    int position = 0, blockStart = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DryWetMixer)
+};
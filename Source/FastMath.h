@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstring>
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
+
+//==============================================================================
+/**
+    Approximate conversions between linear gain and decibels without libm.
+
+    log2 and exp2 are split into exponent and mantissa through the bit pattern of
+    the float, only the mantissa part goes through a polynomial (the minimax
+    approximation of log2(1 + t) resp. the interpolation of 2 ^ t at the
+    Chebyshev-Lobatto nodes of [0, 1], both exact at the ends of the interval,
+    so the result is continuous across octaves). There are no branches or table
+    lookups, so the array versions vectorise.
+
+    Maximum error over the whole range of normal floats, checked for every one
+    of them by FastMathTests:
+      gainToDecibels / powerToDecibels  0.0008 dB (log2 error 1.3e-4)
+      decibelsToGain                    0.0014 dB (relative error 1.6e-4)
+
+    Gains below the smallest normal float (including 0) are treated as that
+    float, decibelsToGain() saturates at the range of normal floats.
+*/
+struct FastMath
+{
+    /** log2(x) for x > 0. */
+    static float log2(float x)
+    {
+        int32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits = jmax(bits, (int32) 0x00800000); // smallest normal float, also catches x <= 0
+
+        const float exponent = (float) ((bits >> 23) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+        const float t = mantissa - 1.0f;
+
+        return exponent + t * (1.43872575f + t * (-0.677784013f + t * (0.321188983f + t * -0.0821307177f)));
+    }
+
+    /** 2 ^ x. */
+    static float exp2(float x)
+    {
+        return exp2Normal(jlimit(minExponent, maxExponent, x));
+    }
+
+    //==============================================================================
+
+    /** 20 * log10(gain), never below minusInfinityDb. */
+    static float gainToDecibels(float gain, float minusInfinityDb = -100.0f)
+    {
+        const float log2ToDecibels = 6.02059991f; // 20 * log10(2)
+        return jmax(log2ToDecibels * log2(gain), minusInfinityDb);
+    }
+
+    /** 10 ^ (decibels / 20), 0 at or below minusInfinityDb. */
+    static float decibelsToGain(float decibels, float minusInfinityDb = -100.0f)
+    {
+        const float decibelsToLog2 = 0.166096405f; // log2(10) / 20
+        return (decibels > minusInfinityDb) ? exp2(decibels * decibelsToLog2) : 0.0f;
+    }
+
+    /** 10 * log10(power) for squared levels. */
+    static void powerToDecibels(const float* src, float* dest, int num)
+    {
+        const float log2ToDecibels = 3.01029996f; // 10 * log10(2)
+
+        for (int i = 0; i < num; ++i)
+            dest[i] = log2ToDecibels * log2(src[i]);
+    }
+
+    /** 10 ^ (decibels / 20) without a lower limit. */
+    static void decibelsToGain(const float* src, float* dest, int num)
+    {
+        const float decibelsToLog2 = 0.166096405f; // log2(10) / 20
+
+        FloatVectorOperations::copyWithMultiply(dest, src, decibelsToLog2, num);
+        FloatVectorOperations::clip(dest, dest, minExponent, maxExponent, num);
+
+        for (int i = 0; i < num; ++i)
+            dest[i] = exp2Normal(dest[i]);
+    }
+
+private:
+    // Range of exponents that give a normal float, clamped outside of the loops
+    // since a clamp inside them stops the compiler from vectorising.
+    static constexpr float minExponent = -126.0f;
+    static constexpr float maxExponent = 127.99f;
+
+    /** 2 ^ x for x in [minExponent, maxExponent]. */
+    static float exp2Normal(float x)
+    {
+        x += 127.0f;
+
+        const int exponent = (int) x; // x is positive, so truncation is floor
+        const float t = x - (float) exponent;
+
+        const int32 bits = exponent << 23;
+        float power;
+        std::memcpy(&power, &bits, sizeof(power));
+
+        return power * (1.0f + t * (0.695542705f + t * (0.225371593f + t * 0.0790857013f)));
+    }
+};
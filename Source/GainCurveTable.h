@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Static curve of the compressor baked into a lookup table.
+
+    The table holds the gain reduction xg - yg over the distance of the input
+    level to the threshold, so only ratio and knee width are baked in. A threshold
+    change doesn't need a new table, and since the knee of a hard curve always lies
+    exactly on a table point, linear interpolation reproduces the hard curve exactly.
+
+    A ratio or knee change only requests a new table from the audio thread, the
+    table is built on the message thread and handed over through a lock free
+    triple buffer, so the audio thread never waits and never sees a half written
+    table. Every table records the ratio and knee it was built for. Until the
+    new one arrives TableCurve computes the exact curve instead, so automation
+    doesn't lag behind in offline renders or while the message thread is busy.
+*/
+class GainCurveTable : private AsyncUpdater
+{
+public:
+    enum {
+        pointsPerDecibel = 4,
+        numPoints = 512,                // covers 128 dB from minDistance on
+        tableSize = numPoints + 1       // one guard point, so interpolation never reads past the end
+    };
+
+    static constexpr float minDistance = -16.0f; // below half of the widest knee, the reduction is 0 there
+
+    struct Table
+    {
+        float points[tableSize];
+        float ratio, knee;  // parameters the table was built for
+    };
+
+    GainCurveTable()
+    {
+        for (auto& table : tables) {
+            std::fill(table.points, table.points + tableSize, 0.0f);
+            table.ratio = 1.0f;
+            table.knee = 0.0f;
+        }
+    }
+
+    ~GainCurveTable()
+    {
+        cancelPendingUpdate();
+    }
+
+    /**
+        Gain reduction xg - yg of the static curve, with a quadratic soft knee of
+        the given width around the threshold (a hard knee for a width of 0).
+    */
+    static float computeReduction(float xg, float threshold, float ratio, float knee)
+    {
+        const float distance = xg - threshold;
+        const float slope = 1.0f - 1.0f / ratio;
+
+        if (2.0f * distance <= -knee)
+            return 0.0f;
+
+        if (2.0f * distance < knee) {
+            const float x = distance + 0.5f * knee;
+            return slope * x * x / (2.0f * knee);
+        }
+
+        return slope * distance;
+    }
+
+    //============================== Audio thread ==============================
+
+    /** Requests a new table if ratio or knee width changed. */
+    void setParameters(float newRatio, float newKnee)
+    {
+        if (newRatio != ratio || newKnee != knee) {
+            ratio = newRatio;
+            knee = newKnee;
+            requestedRatio.store(newRatio, std::memory_order_relaxed);
+            requestedKnee.store(newKnee, std::memory_order_relaxed);
+            triggerAsyncUpdate();
+        }
+    }
+
+    /** Returns the most recently built table, it stays valid until the next call. */
+    const Table& acquire()
+    {
+        if (middle.load(std::memory_order_relaxed) & newTableFlag)
+            front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+
+        return tables[front];
+    }
+
+    //============================= Message thread =============================
+
+    /** Builds the table right away if one was requested, call from prepareToPlay. */
+    void update()
+    {
+        handleUpdateNowIfNeeded();
+    }
+
+    /** Last table built, for drawing the transfer curve. */
+    const Table& getDisplayTable() const { return displayTable; }
+
+    //==============================================================================
+
+    /** Reduction at the given distance of the input level to the threshold. */
+    static float lookup(const Table& table, float distance)
+    {
+        const float position = jlimit(0.0f, (float) (numPoints - 1), (distance - minDistance) * pointsPerDecibel);
+        const int index = (int) position;
+        return table.points[index] + (position - (float) index) * (table.points[index + 1] - table.points[index]);
+    }
+
+private:
+    enum {
+        indexMask = 3,
+        newTableFlag = 4
+    };
+
+    void handleAsyncUpdate() override
+    {
+        const float r = requestedRatio.load(std::memory_order_relaxed);
+        const float k = requestedKnee.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < tableSize; ++i)
+            displayTable.points[i] = computeReduction(minDistance + (float) i / pointsPerDecibel, 0.0f, r, k);
+        displayTable.ratio = r;
+        displayTable.knee = k;
+
+        tables[back] = displayTable;
+        back = middle.exchange(back | newTableFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    Table tables[3];
+    Table displayTable = {};
+
+    // Triple buffer: the audio thread reads tables[front], the message thread writes
+    // tables[back], the one in the middle is swapped with either side atomically
+    int front = 0;
+    int back = 1;
+    std::atomic<int> middle{ 2 };
+
+    // Last values seen on the audio thread and the values the table is requested for
+    float ratio = 0.0f, knee = -1.0f;
+    std::atomic<float> requestedRatio{ 1.0f }, requestedKnee{ 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GainCurveTable)
+};
+
+//==============================================================================
+/**
+    Gain computer policy: looks the reduction up in a GainCurveTable, the cost
+    is the same for every curve shape. While the table is still being built for
+    new parameters, the exact curve is computed instead.
+*/
+struct TableCurve
+{
+    void process(float* data, int num) const
+    {
+        if (!isCurrent()) {
+            for (int i = 0; i < num; ++i)
+                data[i] = GainCurveTable::computeReduction(data[i], threshold, ratio, knee);
+            return;
+        }
+
+        const float* points = table->points;
+        const float offset = -threshold - GainCurveTable::minDistance;
+
+        FloatVectorOperations::add(data, offset, num);
+        FloatVectorOperations::multiply(data, (float) GainCurveTable::pointsPerDecibel, num);
+        FloatVectorOperations::clip(data, data, 0.0f, (float) (GainCurveTable::numPoints - 1), num);
+
+        for (int i = 0; i < num; ++i) {
+            const int index = (int) data[i];
+            const float fraction = data[i] - (float) index;
+            data[i] = points[index] + fraction * (points[index + 1] - points[index]);
+        }
+    }
+
+    /** Interleaved lanes of the unlinked kernels, one SIMD register per frame, starting at channel first. */
+    void processLanes(float* lanes, int numFrames, int /*first*/) const
+    {
+        process(lanes, numFrames * (int) dsp::SIMDRegister<float>::SIMDNumElements);
+    }
+
+    /** Reduction of a single level in dB. */
+    float computeReduction(float xg) const
+    {
+        return isCurrent() ? GainCurveTable::lookup(*table, xg - threshold)
+                           : GainCurveTable::computeReduction(xg, threshold, ratio, knee);
+    }
+
+    /** Input level in dB up to which the reduction is 0. */
+    float getLowerLimit() const { return threshold - 0.5f * knee; }
+
+    /** True if the table was built for the ratio and knee of this curve. */
+    bool isCurrent() const { return table->ratio == ratio && table->knee == knee; }
+
+    const GainCurveTable::Table* table;
+    float threshold;
+    float ratio, knee;
+};
@@ -28,8 +28,18 @@ Level1Editor::Level1Editor(Ckpa_compressorAudioProcessor& p) : processor(p)
 {
     const Array<AudioProcessorParameter*> parameters = processor.getParameters();
 
+    // Only the parameters in front of the compression parameter, the knee and the link amount are shown in level 1
+    const AudioProcessorParameter* compressionParameter =
+        processor.parameters.valueTreeState.getParameter(processor.paramCompression.paramID);
+
+    Array<int> indices;
+    for (int i = 0; parameters[i] != compressionParameter; ++i)
+        indices.add(i);
+    indices.add(processor.parameters.valueTreeState.getParameter(processor.paramKnee.paramID)->getParameterIndex());
+    indices.add(processor.parameters.valueTreeState.getParameter(processor.paramLinkAmount.paramID)->getParameterIndex());
+
     int editorHeight = 2 * editorMargin;
-    for (int i = 0; i < parameters.size() - 1; ++i) {
+    for (int i : indices) {
         if (const AudioProcessorParameterWithID* parameter = dynamic_cast<AudioProcessorParameterWithID*> (parameters[i])) {
             if (processor.parameters.parameterTypes[i] == "Slider") {
                 Slider* aSlider;
@@ -53,9 +63,22 @@ Level1Editor::Level1Editor(Ckpa_compressorAudioProcessor& p) : processor(p)
             components.getLast()->setName(parameter->name);
             components.getLast()->setComponentID(parameter->paramID);
             addAndMakeVisible(components.getLast());
+
+            if (parameter->paramID == processor.paramLinkAmount.paramID) {
+                linkAmountSlider = sliders.getLast();
+                linkAmountLabel = aLabel;
+                linkAmountSlider->setTooltip("Blends the envelope of every unlinked channel with the loudest one. "
+                                             "Only applies in compressor mode with Channel Link Unlinked, "
+                                             "Link Groups Off and Stereo Mode Left/Right");
+            }
         }
     }
 
+    // Link Amount is greyed out while the other settings ignore it
+    for (const String& paramID : getLinkAmountConditions())
+        processor.parameters.valueTreeState.addParameterListener(paramID, this);
+    handleAsyncUpdate();
+
     //============ Level Meters ============
 
     lnf.setColour(foleys::LevelMeter::lmMeterBackgroundColour, getLookAndFeel().findColour(Slider::backgroundColourId));
@@ -91,6 +114,10 @@ Level1Editor::Level1Editor(Ckpa_compressorAudioProcessor& p) : processor(p)
 
 Level1Editor::~Level1Editor()
 {
+    for (const String& paramID : getLinkAmountConditions())
+        processor.parameters.valueTreeState.removeParameterListener(paramID, this);
+    cancelPendingUpdate();
+
     for (auto* m : levelMeters) {
         m->setLookAndFeel(nullptr);
     }
@@ -119,4 +146,24 @@ void Level1Editor::resized()
 
         r = r.removeFromBottom(r.getHeight() - editorPadding);
     }
-}
\ No newline at end of file
+}
+
+//==============================================================================
+
+void Level1Editor::parameterChanged(const String& parameterID, float newValue)
+{
+    triggerAsyncUpdate();
+}
+
+void Level1Editor::handleAsyncUpdate()
+{
+    const bool active = processor.isLinkAmountActive();
+    linkAmountSlider->setEnabled(active);
+    linkAmountLabel->setEnabled(active);
+}
+
+StringArray Level1Editor::getLinkAmountConditions() const
+{
+    return { processor.paramMode.paramID, processor.paramChannelLink.paramID, processor.paramLinkGroups.paramID,
+             processor.paramStereoMode.paramID, processor.paramProcessingKernel.paramID };
+}
@@ -27,7 +27,9 @@
 
 //==============================================================================
 
-class Level1Editor : public Component
+class Level1Editor : public Component,
+                     private AudioProcessorValueTreeState::Listener,
+                     private AsyncUpdater
 {
 public:
     Level1Editor(Ckpa_compressorAudioProcessor& p);
@@ -37,6 +39,13 @@ public:
     void resized() override;
 
 private:
+    // Called on any thread, the link amount slider is updated on the message thread
+    void parameterChanged(const String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+
+    /** IDs of the parameters that decide whether Link Amount applies. */
+    StringArray getLinkAmountConditions() const;
+
     Ckpa_compressorAudioProcessor& processor;
 
     enum {
@@ -59,6 +68,9 @@ private:
     OwnedArray<Label> labels;
     Array<Component*> components;
 
+    Slider* linkAmountSlider = nullptr;
+    Label* linkAmountLabel = nullptr;
+
     typedef AudioProcessorValueTreeState::SliderAttachment SliderAttachment;
     typedef AudioProcessorValueTreeState::ButtonAttachment ButtonAttachment;
 
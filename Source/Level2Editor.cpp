@@ -62,8 +62,8 @@ Level2Editor::Level2Editor(Ckpa_compressorAudioProcessor& p, Component* parentFo
 
             std::function<float(float, float, float)> convertFrom0To1Func, convertTo0To1Func;
             if (i == 0) { // Set conversion function for threshold line, create logarithmic behaviour
-                convertFrom0To1Func = [](float start, float end, float x) { return Decibels::gainToDecibels(x, start); };
-                convertTo0To1Func = [](float start, float end, float x) { return Decibels::decibelsToGain(x, start); };
+                convertFrom0To1Func = [](float start, float end, float x) { return FastMath::gainToDecibels(x, start); };
+                convertTo0To1Func = [](float start, float end, float x) { return FastMath::decibelsToGain(x, start); };
             }
             else if (i == 1) { // Set conversion function for ratio line so the value is relative to the slope of the line
                 convertFrom0To1Func = [](float start, float end, float x) { return (x <= 0) ? start : (x >= 1) ? end : 1 / (1 - x); };
@@ -86,7 +86,13 @@ Level2Editor::~Level2Editor()
 void Level2Editor::changeListenerCallback(ChangeBroadcaster* source)
 {
     Ckpa_compressorAudioProcessor* p = dynamic_cast<Ckpa_compressorAudioProcessor*> (source);
-    visualiser.pushBuffer(p->bufferBefore, p->bufferAfter);
+
+    // Only the range of every block is published by the processor, not the signal itself
+    SignalTap::Summary summaries[64];
+    int numRead;
+    while ((numRead = p->signalTap.popSummaries(summaries, 64)) > 0)
+        for (int i = 0; i < numRead; ++i)
+            visualiser.pushSummary(summaries[i].before, summaries[i].after, summaries[i].numSamples);
 }
 
 void Level2Editor::sliderValueChanged(Slider* slider)
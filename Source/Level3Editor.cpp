@@ -122,7 +122,7 @@ void Level3Editor::timerCallback()
 {
     // Change amount of visible atoms according to current input level
     float rms = processor.meterSourceInput.getRMSLevel(0);
-    float rmsDb = juce::Decibels::gainToDecibels(rms, -60.0f) + 3;
+    float rmsDb = FastMath::gainToDecibels(rms, -60.0f) + 3;
     int visibleTarget = ceilf(jmin(1.0f, (1 - rmsDb / -70.0f)) * numAtoms);
     std::random_device rand;
     std::mt19937 g(rand());
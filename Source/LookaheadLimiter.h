@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "BlockLevels.h"
+#include "CompressorKernel.h"
+
+//==============================================================================
+/**
+    Maximum over the last windowSize values, using a monotonic deque: values that
+    can never become the maximum again are dropped as soon as a larger one
+    arrives. Every value is pushed and popped at most once, so the cost per
+    sample is constant on average, whatever the window size.
+*/
+class SlidingMaximum
+{
+public:
+    /** Allocates space for windows of up to maxWindowSize values. */
+    void prepare(int maxWindowSize)
+    {
+        values.resize(maxWindowSize);
+        times.resize(maxWindowSize);
+        setWindowSize(maxWindowSize);
+    }
+
+    /** Sets the window size and forgets all values, doesn't allocate. */
+    void setWindowSize(int newWindowSize)
+    {
+        jassert(newWindowSize > 0 && newWindowSize <= (int) values.size());
+        windowSize = newWindowSize;
+        head = 0;
+        size = 0;
+        time = 0;
+    }
+
+    /** Adds a value and returns the maximum of the window ending with it. */
+    float push(float value)
+    {
+        const int capacity = (int) values.size();
+
+        // Drop values at the back that are not larger than the new one
+        while (size > 0 && values[index(size - 1, capacity)] <= value)
+            --size;
+
+        // Drop the front value if it left the window
+        if (size > 0 && times[head] <= time - windowSize) {
+            head = (head + 1 == capacity) ? 0 : head + 1;
+            --size;
+        }
+
+        const int back = index(size, capacity);
+        values[back] = value;
+        times[back] = time;
+        ++size;
+        ++time;
+
+        return values[head];
+    }
+
+private:
+    int index(int position, int capacity) const
+    {
+        const int i = head + position;
+        return (i >= capacity) ? i - capacity : i;
+    }
+
+    std::vector<float> values;
+    std::vector<int64> times;
+    int windowSize = 1, head = 0, size = 0;
+    int64 time = 0;
+};
+
+//==============================================================================
+/**
+    Brickwall limiter with a lookahead delay.
+
+    The peak of all channels is held for the length of the lookahead, the gain
+    needed to keep that peak at the ceiling drops instantly and recovers with the
+    release coefficient. A moving average over the lookahead then turns the drops
+    into ramps, and since all values it averages are already low enough for every
+    peak still in the delay line, no sample leaves the limiter above the ceiling.
+    The makeup gain is applied before the peaks are detected, so it can't push
+    the output above the ceiling either.
+*/
+class LookaheadLimiter
+{
+public:
+    enum { chunkSize = 64 };
+
+    /** Allocates the delay lines, call from prepareToPlay. */
+    void prepare(int numChannels, int maxLookahead)
+    {
+        delayLines.setSize(numChannels, jmax(maxLookahead, 1));
+        averageLine.resize(jmax(maxLookahead, 1));
+        slidingMaximum.prepare(maxLookahead + 1);
+        setLookahead(maxLookahead);
+    }
+
+    /** Sets the lookahead in samples and clears the state, doesn't allocate. */
+    void setLookahead(int newLookahead)
+    {
+        jassert(newLookahead <= delayLines.getNumSamples());
+
+        lookahead = newLookahead;
+        pendingLookahead = newLookahead;
+        fadeInRemaining = 0;
+        delayLines.clear();
+        std::fill(averageLine.begin(), averageLine.end(), 1.0f);
+        slidingMaximum.setWindowSize(lookahead + 1);
+
+        position = 0;
+        averageSum = jmax(lookahead, 1);
+        heldGain = 1.0;
+    }
+
+    /**
+        Changes the lookahead while audio is running. The delay lines can't keep
+        their contents across the change, so the next chunk fades out, the state
+        is cleared and the input fades back in over a chunk. The audio in the
+        delay lines at that point is dropped, but the change doesn't click.
+    */
+    void changeLookahead(int newLookahead)
+    {
+        jassert(newLookahead <= delayLines.getNumSamples());
+        pendingLookahead = newLookahead;
+    }
+
+    /** The lookahead in samples, a pending change applies during the next chunk. */
+    int getLookahead() const { return lookahead; }
+    int getMaxLookahead() const { return (int) averageLine.size(); }
+
+    /**
+        Applies the makeup gain to one chunk of all channels and limits them in
+        place to the ceiling (as a gain). The output is delayed by the lookahead.
+    */
+    template <typename SampleType>
+    void process(SampleType* const* channels, int numChannels, int start, int num,
+                 float ceiling, float alphaR, float makeupGain, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        float peak[chunkSize], control[chunkSize];
+        const int averageLength = jmax(lookahead, 1);
+        const float inverseAverageLength = makeupGain / (float) averageLength;
+
+        if (fadeInRemaining > 0)
+            fadeIn(channels, numChannels, start, num);
+
+        // The peaks after the makeup gain, so the ceiling holds for the output
+        FloatVectorOperations::clear(peak, num);
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < num; ++i)
+                peak[i] = jmax(peak[i], (float) std::abs(channels[channel][start + i]));
+        FloatVectorOperations::multiply(peak, makeupGain, num);
+
+        const int chunkPosition = position;
+
+        for (int i = 0; i < num; ++i) {
+            const float heldPeak = slidingMaximum.push(peak[i]);
+            const float target = (heldPeak > ceiling) ? ceiling / heldPeak : 1.0f;
+
+            // Instant attack, the moving average below provides the ramp
+            heldGain = (target < heldGain) ? target : alphaR * heldGain + (1.0 - alphaR) * target;
+
+            // The sum adds exactly what the line stores, so removing it later doesn't drift
+            const float gain = (float) heldGain;
+            averageSum += gain - averageLine[position];
+            averageLine[position] = gain;
+            control[i] = (float) averageSum * inverseAverageLength;
+
+            if (lookahead > 0)
+                position = (position + 1 == lookahead) ? 0 : position + 1;
+        }
+
+        const bool fadeOut = pendingLookahead != lookahead;
+        if (fadeOut)
+            for (int i = 0; i < num; ++i)
+                control[i] *= (float) (num - 1 - i) / (float) num;
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            SampleType* data = channels[channel] + start;
+
+            if (lookahead > 0)
+                delay(delayLines.getWritePointer(channel), chunkPosition, data, num);
+
+            applyControlToChannel<1>(data, control, num, levels[channel]);
+        }
+
+        if (fadeOut) {
+            setLookahead(pendingLookahead);
+            fadeInRemaining = chunkSize;
+        }
+    }
+
+private:
+    /** Fades the input in over chunkSize samples after a lookahead change. */
+    template <typename SampleType>
+    void fadeIn(SampleType* const* channels, int numChannels, int start, int num)
+    {
+        const int length = jmin(num, fadeInRemaining);
+        const int done = chunkSize - fadeInRemaining;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < length; ++i)
+                channels[channel][start + i] *= (SampleType) (done + i + 1) / (SampleType) chunkSize;
+
+        fadeInRemaining -= length;
+    }
+
+    /** Swaps a chunk with the delay line, starting at the given position. */
+    template <typename SampleType>
+    void delay(double* line, int p, SampleType* data, int num) const
+    {
+        for (int i = 0; i < num; ++i) {
+            const double delayed = line[p];
+            line[p] = data[i];
+            data[i] = (SampleType) delayed;
+            p = (p + 1 == lookahead) ? 0 : p + 1;
+        }
+    }
+
+    // Double delay lines hold float and double samples without any loss
+    AudioBuffer<double> delayLines;
+    std::vector<float> averageLine;
+    SlidingMaximum slidingMaximum;
+
+    int lookahead = 0;
+    int pendingLookahead = 0;
+    int fadeInRemaining = 0;    // input samples still to fade in after a lookahead change
+    int position = 0;
+    double averageSum = 1.0;    // double, so adding and removing values doesn't drift
+    double heldGain = 1.0;
+};
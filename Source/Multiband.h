@@ -0,0 +1,417 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "BlockLevels.h"
+#include "CompressorKernel.h"
+#include "DetectorFilter.h"
+#include "FastMath.h"
+#include "GainCurveTable.h"
+
+//==============================================================================
+/**
+    Splits interleaved signals into 3 or 4 bands with 4th order Linkwitz-Riley
+    crossovers (two cascaded Butterworth biquads each).
+
+    The signal is split at the middle crossover first, then each half again at
+    its own crossover. Each half also runs through the allpass of the other
+    half's crossover, so all bands end up with the same phase response and their
+    sum is the input through the allpasses of all crossovers, with a flat
+    magnitude response. Like the detector filter, all filters run on one channel
+    per lane of a SIMD register.
+*/
+class LinkwitzRileyCrossover
+{
+public:
+    enum {
+        maxBands = 4,
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes
+    };
+
+    /** Allocates the filter states for the given number of groups of numLanes channels. */
+    void prepare(double newSampleRate, int numGroups)
+    {
+        states.resize(numGroups * numFilters * stateSize);
+        setSampleRate(newSampleRate);
+    }
+
+    /** Clears the filter states, the next frequencies get new coefficients. Doesn't allocate. */
+    void setSampleRate(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        numBands = 0;
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(states.begin(), states.end(), 0.0f);
+    }
+
+    /**
+        Sets the number of bands (3 or 4) and the numBands - 1 crossover frequencies
+        in ascending order. Coefficients are only recomputed for frequencies that
+        changed, a new number of bands also clears the filter states.
+    */
+    void setFrequencies(int newNumBands, const float* newFrequencies)
+    {
+        jassert(newNumBands == 3 || newNumBands == maxBands);
+
+        if (newNumBands != numBands) {
+            numBands = newNumBands;
+            std::fill(frequencies, frequencies + maxBands - 1, -1.0f);
+            reset();
+        }
+
+        for (int k = 0; k < numBands - 1; ++k) {
+            if (newFrequencies[k] != frequencies[k]) {
+                frequencies[k] = newFrequencies[k];
+                lowPass[k] = BiquadCoefficients::lowPass(sampleRate, frequencies[k]);
+                highPass[k] = BiquadCoefficients::highPass(sampleRate, frequencies[k]);
+                allPass[k] = BiquadCoefficients::allPass(sampleRate, frequencies[k]);
+            }
+        }
+    }
+
+    int getNumBands() const { return numBands; }
+
+    /**
+        Splits one chunk of a group of interleaved channels into the bands, each
+        band is interleaved the same way. input and bands have to be aligned.
+    */
+    void process(int group, const float* input, int num, float* const* bands)
+    {
+        jassert(num <= chunkSize);
+
+        float* state = &states[group * numFilters * stateSize];
+        const int size = num * numLanes;
+
+        // Split at the middle crossover, the bands of the high half start out in bands[2]
+        std::copy(input, input + size, bands[0]);
+        std::copy(input, input + size, bands[2]);
+        linkwitzRiley(lowPass[middle], state, middleLow, bands[0], num);
+        linkwitzRiley(highPass[middle], state, middleHigh, bands[2], num);
+
+        // Low half: allpass of the high crossover, then split at the low crossover
+        if (numBands == maxBands)
+            Biquad::processLanes(allPass[high], state + lowAllPass * stateSize, bands[0], num);
+        std::copy(bands[0], bands[0] + size, bands[1]);
+        linkwitzRiley(lowPass[low], state, lowLow, bands[0], num);
+        linkwitzRiley(highPass[low], state, lowHigh, bands[1], num);
+
+        // High half: allpass of the low crossover, then split at the high crossover
+        Biquad::processLanes(allPass[low], state + highAllPass * stateSize, bands[2], num);
+        if (numBands == maxBands) {
+            std::copy(bands[2], bands[2] + size, bands[3]);
+            linkwitzRiley(lowPass[high], state, highLow, bands[2], num);
+            linkwitzRiley(highPass[high], state, highHigh, bands[3], num);
+        }
+    }
+
+private:
+    enum Crossover { low, middle, high };
+
+    enum Filter {
+        middleLow, middleHigh = middleLow + 2,
+        lowAllPass = middleHigh + 2, lowLow, lowHigh = lowLow + 2,
+        highAllPass = lowHigh + 2, highLow, highHigh = highLow + 2,
+        numFilters = highHigh + 2
+    };
+
+    enum { stateSize = 2 * numLanes }; // s1 and s2 of every lane
+
+    /** 4th order Linkwitz-Riley filter: the same Butterworth biquad twice. */
+    static void linkwitzRiley(const BiquadCoefficients& c, float* state, int filter, float* lanes, int num)
+    {
+        Biquad::processLanes(c, state + filter * stateSize, lanes, num);
+        Biquad::processLanes(c, state + (filter + 1) * stateSize, lanes, num);
+    }
+
+    std::vector<float> states;
+    BiquadCoefficients lowPass[maxBands - 1], highPass[maxBands - 1], allPass[maxBands - 1];
+    float frequencies[maxBands - 1] = { -1.0f, -1.0f, -1.0f };
+    int numBands = 0;
+    double sampleRate = 44100.0;
+};
+
+//==============================================================================
+/**
+    Multiband compressor with 3 or 4 bands. Every band has its own threshold,
+    ratio, attack, release and makeup gain, the knee width is shared.
+
+    The mixdown of the detector input is split by its own crossover, and the
+    levels of all bands are packed into the lanes of one SIMD register. The dB
+    conversion, the envelope and the conversion back to a gain handle all bands
+    in the same instructions, so these stages cost about as much for 4 bands as
+    for a single one. Every channel is split by the audio crossover, the bands
+    are weighted with their control gains and summed back together.
+*/
+class MultibandCompressor
+{
+public:
+    enum {
+        maxBands = LinkwitzRileyCrossover::maxBands,
+        chunkSize = 64,
+        numLanes = CompressorState::numLanes
+    };
+
+    static_assert((int) numLanes >= (int) maxBands, "all bands have to fit into one SIMD register");
+
+    /** Settings of one band: threshold in dB, ratio, attack and release in seconds, makeup gain in dB. */
+    struct Band
+    {
+        float threshold, ratio, attack, release, makeupGain;
+    };
+
+    /** Allocates the filter states, call from prepareToPlay after the first setBand() calls. */
+    void prepare(double sampleRate, int numChannels, double rampLengthInSeconds)
+    {
+        crossover.prepare(sampleRate, (numChannels + numLanes - 1) / numLanes);
+        detectorCrossover.prepare(sampleRate, 1);
+
+        for (int band = 0; band < maxBands; ++band)
+            curves[band].update();
+
+        setSampleRate(sampleRate, rampLengthInSeconds);
+    }
+
+    /** Clears all states and recomputes the coefficients for a new rate, doesn't allocate. */
+    void setSampleRate(double sampleRate, double rampLengthInSeconds)
+    {
+        crossover.setSampleRate(sampleRate);
+        detectorCrossover.setSampleRate(sampleRate);
+
+        for (int band = 0; band < maxBands; ++band) {
+            attackCoefficients[band].reset(sampleRate, rampLengthInSeconds);
+            releaseCoefficients[band].reset(sampleRate, rampLengthInSeconds);
+        }
+
+        std::fill(ylPrev, ylPrev + numLanes, 0.0);
+    }
+
+    /** Updates the settings of one band, a new curve is built on the message thread if needed. */
+    void setBand(int band, const Band& settings, float knee)
+    {
+        curves[band].setParameters(settings.ratio, knee);
+        thresholds[band] = settings.threshold;
+        ratios[band] = settings.ratio;
+        knees[band] = knee;
+        makeupGains[band] = settings.makeupGain;
+        attackCoefficients[band].setTime(settings.attack);
+        releaseCoefficients[band].setTime(settings.release);
+    }
+
+    /** Sets the number of bands and their numBands - 1 crossover frequencies in ascending order. */
+    void setCrossovers(int numBands, const float* frequencies)
+    {
+        crossover.setFrequencies(numBands, frequencies);
+        detectorCrossover.setFrequencies(numBands, frequencies);
+    }
+
+    /**
+        Compresses one chunk of all channels in place. The bands are split in float
+        lanes whatever the sample type, only the samples read and written keep it.
+    */
+    template <typename SampleType>
+    void process(SampleType* const* channels, int numChannels, const DetectorInputOf<SampleType>& detectorInput,
+                 int start, int num, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float control[chunkSize * numLanes];
+
+        computeChunkControl(channels, numChannels, detectorInput, start, num, control);
+        for (int group = 0; group < getNumGroups(numChannels); ++group)
+            processGroup(group, channels, numChannels, start, num, control, levels);
+    }
+
+    /** Number of groups of numLanes channels, each has its own crossover states. */
+    static int getNumGroups(int numChannels) { return (numChannels + numLanes - 1) / numLanes; }
+
+    /**
+        The control gains of one chunk, one per band and sample interleaved with a
+        stride of numLanes, control has to be aligned. Reads the unprocessed input
+        if there is no detector input.
+    */
+    template <typename SampleType>
+    void computeChunkControl(const SampleType* const* channels, int numChannels,
+                             const DetectorInputOf<SampleType>& detectorInput, int start, int num, float* control)
+    {
+        jassert(num <= chunkSize);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float bandData[maxBands][chunkSize * numLanes];
+        float* const bands[maxBands] = { bandData[0], bandData[1], bandData[2], bandData[3] };
+
+        computeControl(channels, numChannels, detectorInput, start, num, bands, control);
+    }
+
+    /**
+        Splits one chunk of the channels of one group into bands, weights them with
+        the control gains and writes the sum. Groups share nothing but the crossover
+        coefficients, so once the control gains are known they can run on different threads.
+    */
+    template <typename SampleType>
+    void processGroup(int group, SampleType* const* channels, int numChannels, int start, int num,
+                      const float* control, BlockLevels& levels)
+    {
+        jassert(num <= chunkSize);
+
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        alignas(Lanes::SIMDRegisterSize) float frames[chunkSize * numLanes];
+        alignas(Lanes::SIMDRegisterSize) float bandData[maxBands][chunkSize * numLanes];
+        float* const bands[maxBands] = { bandData[0], bandData[1], bandData[2], bandData[3] };
+
+        const int numBands = crossover.getNumBands();
+        const int first = group * numLanes;
+        const int numActive = jmin((int) numLanes, numChannels - first);
+
+        if (numActive < numLanes)
+            FloatVectorOperations::clear(frames, num * numLanes);
+
+        for (int lane = 0; lane < numActive; ++lane) {
+            const SampleType* data = channels[first + lane] + start;
+            for (int i = 0; i < num; ++i)
+                frames[i * numLanes + lane] = (float) data[i];
+        }
+
+        crossover.process(group, frames, num, bands);
+
+        // Weighted sum of the bands to frames, the unweighted sum to bands[0] for the gain reduction
+        for (int i = 0; i < num; ++i) {
+            const int frame = i * numLanes;
+            Lanes output = Lanes::expand(0.0f), unity = Lanes::expand(0.0f);
+
+            for (int band = 0; band < numBands; ++band) {
+                const Lanes signal = Lanes::fromRawArray(bands[band] + frame);
+                output += signal * control[frame + band];
+                unity += signal;
+            }
+
+            output.copyToRawArray(frames + frame);
+            unity.copyToRawArray(bands[0] + frame);
+        }
+
+        for (int lane = 0; lane < numActive; ++lane)
+            writeChannel(channels[first + lane] + start, frames + lane, bands[0] + lane, num,
+                         levels[first + lane]);
+    }
+
+private:
+    /**
+        Turns the detector input into one control gain per band and sample,
+        interleaved with a stride of numLanes. bands is used as scratch space.
+    */
+    template <typename SampleType>
+    void computeControl(const SampleType* const* channels, int numChannels,
+                        const DetectorInputOf<SampleType>& detectorInput,
+                        int start, int num, float* const* bands, float* control)
+    {
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        const bool external = detectorInput.channels != nullptr;
+        const SampleType* const* input = external ? detectorInput.channels : channels;
+        const int n = external ? detectorInput.numChannels : numChannels;
+        const int offset = external ? detectorInput.start : start;
+        const int numBands = crossover.getNumBands();
+
+        // Mono mixdown in lane 0, split into bands
+        float mixdown[chunkSize];
+        LinearMixDownDetector::mixDown(input, n, offset, num, mixdown);
+
+        FloatVectorOperations::clear(control, num * numLanes);
+        for (int i = 0; i < num; ++i)
+            control[i * numLanes] = mixdown[i];
+
+        detectorCrossover.process(0, control, num, bands);
+
+        // From here on every band is one lane
+        for (int i = 0; i < num; ++i)
+            for (int band = 0; band < numBands; ++band)
+                control[i * numLanes + band] = bands[band][i * numLanes] * bands[band][i * numLanes];
+
+        MixDownDetector::levelFromPower(control, num * numLanes);
+
+        for (int band = 0; band < numBands; ++band) {
+            const TableCurve curve{ &curves[band].acquire(), thresholds[band], ratios[band], knees[band] };
+            for (int i = 0; i < num; ++i)
+                control[i * numLanes + band] = curve.computeReduction(control[i * numLanes + band]);
+        }
+
+        // Coefficients of the unused lanes don't matter, they are never read back
+        alignas(Lanes::SIMDRegisterSize) float alphaA[numLanes] = {};
+        alignas(Lanes::SIMDRegisterSize) float alphaR[numLanes] = {};
+        alignas(Lanes::SIMDRegisterSize) float makeup[numLanes] = {};
+        for (int band = 0; band < numBands; ++band) {
+            alphaA[band] = attackCoefficients[band].skip(num);
+            alphaR[band] = releaseCoefficients[band].skip(num);
+            makeup[band] = makeupGains[band];
+        }
+
+        BranchingSmoother::processLanes(ylPrev, control,
+                                        LaneCoefficients{ Lanes::fromRawArray(alphaA), Lanes::fromRawArray(alphaR) }, num);
+
+        // 10 ^ ((makeupGain - yl) / 20) for all bands at once
+        const Lanes makeupGain = Lanes::fromRawArray(makeup);
+        for (int i = 0; i < num; ++i) {
+            float* frame = control + i * numLanes;
+            (makeupGain - Lanes::fromRawArray(frame)).copyToRawArray(frame);
+        }
+        FastMath::decibelsToGain(control, control, num * numLanes);
+    }
+
+    /**
+        Writes the output of one channel and accumulates its levels. The output
+        and the unweighted band sum are read with a stride of numLanes, the gain
+        reduction is the difference between the two.
+    */
+    template <typename SampleType>
+    static void writeChannel(SampleType* data, const float* output, const float* unity, int num, ChannelLevels& levels)
+    {
+        ChannelLevels l = levels;
+
+        for (int i = 0; i < num; ++i) {
+            const float oldValue = (float) data[i];
+            const float newValue = output[i * numLanes];
+
+            data[i] = (SampleType) newValue;
+            accumulateLevels(l, oldValue, newValue, unity[i * numLanes] - newValue);
+        }
+
+        levels = l;
+    }
+
+    LinkwitzRileyCrossover crossover, detectorCrossover;
+    GainCurveTable curves[maxBands];
+    EnvelopeCoefficient attackCoefficients[maxBands], releaseCoefficients[maxBands];
+
+    float thresholds[maxBands] = {};
+    float ratios[maxBands] = { 1.0f, 1.0f, 1.0f, 1.0f }, knees[maxBands] = {};   // those of the initial tables
+    float makeupGains[maxBands] = {};
+    double ylPrev[numLanes] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultibandCompressor)
+};
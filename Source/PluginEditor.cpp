@@ -75,7 +75,7 @@ Ckpa_compressorAudioProcessorEditor::Ckpa_compressorAudioProcessorEditor(Ckpa_co
     //======================================
 
     addAndMakeVisible(tabs, 0);
-    setSize(editorWidth, 383);
+    setSize(editorWidth, 418);
 }
 
 Ckpa_compressorAudioProcessorEditor::~Ckpa_compressorAudioProcessorEditor()
@@ -105,5 +105,20 @@ void Ckpa_compressorAudioProcessorEditor::resetParameters()
     processor.paramAttack.resetParameter();
     processor.paramRelease.resetParameter();
     processor.paramMakeupGain.resetParameter();
+    processor.paramKnee.resetParameter();
+    processor.paramLookahead.resetParameter();
+    processor.paramSidechainHighPass.resetParameter();
+    processor.paramSidechainTilt.resetParameter();
+    processor.paramCrossover1.resetParameter();
+    processor.paramCrossover2.resetParameter();
+    processor.paramCrossover3.resetParameter();
+    processor.paramRmsWindow.resetParameter();
+    processor.paramMix.resetParameter();
+    processor.paramGateThreshold.resetParameter();
+    processor.paramGateRange.resetParameter();
+    processor.paramGateHysteresis.resetParameter();
+    processor.paramLinkAmount.resetParameter();
+    for (PluginParameterBand* band : processor.paramBands)
+        band->resetParameters();
     processor.paramCompression.resetParameter();
 }
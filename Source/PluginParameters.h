@@ -56,10 +56,18 @@ protected:
 public:
     void updateValue(float value)
     {
-        if (callback != nullptr)
-            setCurrentAndTargetValue(callback(value));
+        const float newValue = (callback != nullptr) ? callback(value) : value;
+
+        if (smoothed)
+            setTargetValue(newValue);
         else
-            setCurrentAndTargetValue(value);
+            setCurrentAndTargetValue(newValue);
+    }
+
+    /** A smoothed parameter ramps to new values over the time given to reset() instead of jumping. */
+    void setSmoothed(bool shouldBeSmoothed)
+    {
+        smoothed = shouldBeSmoothed;
     }
 
     void parameterChanged(const String& parameterID, float newValue) override
@@ -76,6 +84,7 @@ public:
     PluginParametersManager& parametersManager;
     std::function<float(float)> callback;
     String paramID;
+    bool smoothed = false;
 };
 
 //==============================================================================
@@ -206,6 +215,86 @@ public:
 
 //==============================================================================
 
+class PluginParameterComboBox : public PluginParameter
+{
+public:
+    PluginParameterComboBox(PluginParametersManager& parametersManager,
+        const String& paramName,
+        const StringArray items,
+        const int defaultChoice = 0,
+        const std::function<float(float)> callback = nullptr,
+        const bool automatable = true)
+        : PluginParameter(parametersManager, callback)
+        , paramName(paramName)
+        , items(items)
+        , defaultChoice(defaultChoice)
+    {
+        paramID = paramName.removeCharacters(" ").toLowerCase();
+        parametersManager.parameterTypes.add("ComboBox");
+
+        parametersManager.comboBoxItemLists.add(items);
+        NormalisableRange<float> range(0.0f, (float)items.size() - 1.0f, 1.0f);
+
+        parametersManager.valueTreeState.createAndAddParameter(std::make_unique<Parameter>
+            (paramID, paramName, "", range, (float)defaultChoice,
+                [items](float value) { return items[(int)value]; },
+                [items](const String& text) { return items.indexOf(text); },
+                false, automatable)
+        );
+
+        parametersManager.valueTreeState.addParameterListener(paramID, this);
+        updateValue((float)defaultChoice);
+    }
+
+    const String& paramName;
+    const StringArray items;
+    const int defaultChoice;
+};
+
+//==============================================================================
+
+/** Parameter set of one band of the multiband mode, the names start with "Band <number>". */
+class PluginParameterBand
+{
+public:
+    PluginParameterBand(PluginParametersManager& parametersManager, int bandNumber)
+        : threshold(parametersManager, "Band " + String(bandNumber) + " Threshold", "dB", -60.0f, 0.0f, 0.0f)
+        , ratio(parametersManager, "Band " + String(bandNumber) + " Ratio", ":1", 1.0f, 100.0f, 1.0f)
+        , attack(parametersManager, "Band " + String(bandNumber) + " Attack", "ms", 0.1f, 100.0f, 2.0f,
+                 [](float value) { return value * 0.001f; })
+        , release(parametersManager, "Band " + String(bandNumber) + " Release", "ms", 10.0f, 1000.0f, 300.0f,
+                  [](float value) { return value * 0.001f; })
+        , gain(parametersManager, "Band " + String(bandNumber) + " Gain", "dB", -12.0f, 12.0f, 0.0f)
+    {
+    }
+
+    void reset(double sampleRate, double rampLengthInSeconds)
+    {
+        threshold.reset(sampleRate, rampLengthInSeconds);
+        ratio.reset(sampleRate, rampLengthInSeconds);
+        attack.reset(sampleRate, rampLengthInSeconds);
+        release.reset(sampleRate, rampLengthInSeconds);
+        gain.reset(sampleRate, rampLengthInSeconds);
+    }
+
+    void resetParameters()
+    {
+        threshold.resetParameter();
+        ratio.resetParameter();
+        attack.resetParameter();
+        release.resetParameter();
+        gain.resetParameter();
+    }
+
+    PluginParameterLinSlider threshold;
+    PluginParameterLinSlider ratio;
+    PluginParameterLinSlider attack;
+    PluginParameterLinSlider release;
+    PluginParameterLinSlider gain;
+};
+
+//==============================================================================
+
 class ThumbOnlySlider : public LookAndFeel_V4
 {
 public:
@@ -31,6 +31,7 @@ Ckpa_compressorAudioProcessor::Ckpa_compressorAudioProcessor()
                     #if ! JucePlugin_IsMidiEffect
                     #if ! JucePlugin_IsSynth
                             .withInput("Input", AudioChannelSet::stereo(), true)
+                            .withInput("Sidechain", AudioChannelSet::stereo(), false)
                     #endif
                             .withOutput("Output", AudioChannelSet::stereo(), true)
                     #endif
@@ -44,12 +45,48 @@ Ckpa_compressorAudioProcessor::Ckpa_compressorAudioProcessor()
     , paramMakeupGain(parameters, "Makeup Gain", "dB", -12.0f, 12.0f, 0.0f)
     , paramBypass(parameters, "")
     , paramCompression(parameters, "Compression", "ck", 0.0f, 20.0f, 20.0f)
+    , paramControlInterval(parameters, "Control Interval", { "1", "8", "16", "32" }, 0,
+                           [](float value) { const int intervals[] = { 1, 8, 16, 32 }; return (float) intervals[(int) value]; })
+    , paramKnee(parameters, "Knee", "dB", 0.0f, 24.0f, 0.0f)
+    , paramDetector(parameters, "Detector", { "Logarithmic", "Linear" }, 0)
+    , paramChannelLink(parameters, "Channel Link", { "Linked", "Unlinked" }, 0)
+    , paramMode(parameters, "Mode", { "Compressor", "Limiter", "Multiband" }, 0)
+    , paramLookahead(parameters, "Lookahead", "ms", 0.0f, 10.0f, 5.0f, [](float value) { return value * 0.001f; })
+    , paramSidechainHighPass(parameters, "SC High Pass", "Hz", DetectorFilter::highPassOff, 500.0f, DetectorFilter::highPassOff)
+    , paramSidechainTilt(parameters, "SC Tilt", "dB", -12.0f, 12.0f, 0.0f)
+    , paramNumBands(parameters, "Bands", { "3", "4" }, 1, [](float value) { return value + 3.0f; })
+    , paramCrossover1(parameters, "Crossover 1", "Hz", 40.0f, 1000.0f, 200.0f)
+    , paramCrossover2(parameters, "Crossover 2", "Hz", 200.0f, 5000.0f, 1000.0f)
+    , paramCrossover3(parameters, "Crossover 3", "Hz", 1000.0f, 16000.0f, 5000.0f)
+    , paramDetection(parameters, "Detection", { "Peak", "RMS" }, 0)
+    , paramRmsWindow(parameters, "RMS Window", "ms", 1.0f, 300.0f, 50.0f, [](float value) { return value * 0.001f; })
+    , paramOversampling(parameters, "Oversampling", { "Off", "2x", "4x" }, 0)
+    , paramOversamplingPhase(parameters, "Oversampling Phase", { "Linear", "Minimum" }, 0)
+    , paramStereoMode(parameters, "Stereo Mode", { "Left/Right", "Mid/Side" }, 0)
+    , paramMix(parameters, "Mix", "%", 0.0f, 100.0f, 100.0f, [](float value) { return value * 0.01f; })
+    , paramGateThreshold(parameters, "Gate Threshold", "dB", -90.0f, 0.0f, -60.0f)
+    , paramGateRange(parameters, "Gate Range", "dB", 0.0f, 90.0f, 0.0f)
+    , paramGateHysteresis(parameters, "Gate Hysteresis", "dB", 0.0f, 12.0f, 3.0f)
+    , paramLinkGroups(parameters, "Link Groups", { "Off", "Custom", "Layout Pairs", "Fronts Linked", "All Linked",
+                                                   "Independent" }, 0)
+    , paramProcessingThreads(parameters, "Processing Threads", { "1", "2", "4", "8", "16" }, 0,
+                             [](float value) { return (float) (1 << (int) value); })
+    , paramLinkAmount(parameters, "Link Amount", "%", 0.0f, 100.0f, 0.0f, [](float value) { return value * 0.01f; })
+    , paramProcessingKernel(parameters, "Processing Kernel", { "Block", "Scalar" }, 0, nullptr, false)
 {
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        paramBands.add(new PluginParameterBand(parameters, band + 1));
+
+    // The mix is applied per sample, a jump would click. The link amount ramps chunk by chunk
+    paramMix.setSmoothed(true);
+    paramLinkAmount.setSmoothed(true);
+
     parameters.valueTreeState.state = ValueTree(Identifier(getName().removeCharacters("- ")));
 }
 
 Ckpa_compressorAudioProcessor::~Ckpa_compressorAudioProcessor()
 {
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -57,121 +94,823 @@ Ckpa_compressorAudioProcessor::~Ckpa_compressorAudioProcessor()
 void Ckpa_compressorAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     const double smoothTime = 1e-3;
-    paramThreshold.reset(sampleRate, smoothTime);
-    paramRatio.reset(sampleRate, smoothTime);
-    paramAttack.reset(sampleRate, smoothTime);
-    paramRelease.reset(sampleRate, smoothTime);
-    paramMakeupGain.reset(sampleRate, smoothTime);
     paramBypass.reset(sampleRate, smoothTime);
     paramCompression.reset(sampleRate, smoothTime);
+    paramControlInterval.reset(sampleRate, smoothTime);
+    paramDetector.reset(sampleRate, smoothTime);
+    paramChannelLink.reset(sampleRate, smoothTime);
+    paramMode.reset(sampleRate, smoothTime);
+    paramLookahead.reset(sampleRate, smoothTime);
+    paramDetection.reset(sampleRate, smoothTime);
+    paramRmsWindow.reset(sampleRate, smoothTime);
+    paramOversampling.reset(sampleRate, smoothTime);
+    paramOversamplingPhase.reset(sampleRate, smoothTime);
+    paramStereoMode.reset(sampleRate, smoothTime);
+    paramMix.reset(sampleRate, 0.05);
+    paramLinkGroups.reset(sampleRate, smoothTime);
+    paramProcessingThreads.reset(sampleRate, smoothTime);
+    paramProcessingKernel.reset(sampleRate, smoothTime);
 
     //======================================
 
-    int numInputChannels = getTotalNumInputChannels();
+    int numInputChannels = getMainBusNumInputChannels();
 
-    mixedDownInput.setSize(1, samplesPerBlock);
-    bufferBefore.setSize(numInputChannels, samplesPerBlock);
-    bufferAfter.setSize(numInputChannels, samplesPerBlock);
-    bufferGainReduction.setSize(numInputChannels, samplesPerBlock);
+    blockLevels.prepare(numInputChannels);
 
     meterSourceInput.resize(1, 1024);
     meterSourceOutput.resize(1, 1024);
     meterSourceGainReduction.resize(1, 1024);
 
-    inputLevel = 0.0f;
-    ylPrev = 0.0f;
+    // Everything rate dependent is allocated for the highest oversampling factor
+    const int maxFactor = 1 << maxOversamplingStages;
+    const double maxProcessingRate = maxFactor * sampleRate;
+    const int numOversampledChannels = getTotalNumInputChannels();
+    const bool oversampling = !(bool) paramBypass.getTargetValue() && numOversampledChannels > 0;
+    oversamplingStages = oversampling ? (int) paramOversampling.getTargetValue() : 0;
+    oversamplingPhase = (int) paramOversamplingPhase.getTargetValue();
+    processingRate = sampleRate * (1 << oversamplingStages);
 
-    inverseSampleRate = 1.0f / (float) getSampleRate();
+    compressorState.prepare(numInputChannels, (int) std::ceil(paramRmsWindow.maxValue * 0.001 * maxProcessingRate));
+    updateChannelGroups();
+    receiveChannelGroups();
     inverseE = 1.0f / M_E;
+
+    attackCoefficient.setTime(paramAttack.getTargetValue());
+    releaseCoefficient.setTime(paramRelease.getTargetValue());
+
+    gainCurve.setParameters(paramRatio.getTargetValue(), paramKnee.getTargetValue());
+    gainCurve.update();
+
+    // The detector filter runs on the sidechain if there is one, on the main input otherwise
+    detectorFilter.prepare(processingRate, jmax(numInputChannels, getChannelCountOfBus(true, 1)));
+
+    setMultibandParameters(0);
+    multiband.prepare(processingRate, numInputChannels, smoothTime);
+
+    // Delay lines for the longest lookahead, whole samples at the host rate
+    limiter.prepare(numInputChannels, maxFactor * (int) std::ceil(paramLookahead.maxValue * 0.001 * sampleRate));
+
+    // Longer blocks are processed in slices, which point into the host's channels
+    maxBlockSize = jmax(samplesPerBlock, 1);
+    const int numBufferChannels = jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    floatSliceChannels.assign(numBufferChannels, nullptr);
+    doubleSliceChannels.assign(numBufferChannels, nullptr);
+
+    // The oversamplers also upsample the sidechain, switching between them doesn't allocate
+    floatOversamplers.release();
+    doubleOversamplers.release();
+    if (numOversampledChannels > 0) {
+        if (isUsingDoublePrecision())
+            doubleOversamplers.prepare(numOversampledChannels, maxBlockSize);
+        else
+            floatOversamplers.prepare(numOversampledChannels, maxBlockSize);
+    }
+
+    // The dry path is delayed by up to the longest lookahead plus the slowest oversampler
+    const int maxLatency = (int) std::ceil(paramLookahead.maxValue * 0.001 * sampleRate)
+                         + jmax(floatOversamplers.getMaxLatency(), doubleOversamplers.getMaxLatency());
+    floatMixer.release();
+    doubleMixer.release();
+    if (isUsingDoublePrecision())
+        doubleMixer.prepare(numInputChannels, maxLatency, maxBlockSize);
+    else
+        floatMixer.prepare(numInputChannels, maxLatency, maxBlockSize);
+
+    prepareWorkerPool();
+
+    setProcessingRate(processingRate);
+    updateLatency();
+    cancelPendingUpdate();
+    handleAsyncUpdate();
 }
 
 void Ckpa_compressorAudioProcessor::releaseResources()
 {
+    const SpinLock::ScopedLockType lock(workerPoolLock);
+    workerPool.release();
+}
+
+void Ckpa_compressorAudioProcessor::prepareWorkerPool()
+{
+    const SpinLock::ScopedLockType lock(workerPoolLock);
+
+    const int numInputChannels = getMainBusNumInputChannels();
+    workerPoolThreads = (int) paramProcessingThreads.getTargetValue();
+
+    // One worker less than threads, the audio thread takes its share. More workers than groups would only idle
+    const int maxJobs = jmax(MultibandCompressor::getNumGroups(numInputChannels),
+                             (numInputChannels + CompressorState::numLanes - 1) / CompressorState::numLanes);
+    const int numWorkers = jmin(workerPoolThreads, SystemStats::getNumCpus(), maxJobs) - 1;
+    if (numWorkers > 0) {
+        workerPool.prepare(numWorkers);
+
+        // The kernels and the multiband compressor work in chunks of the same size
+        blockChunkSettings.resize((maxBlockSize + MultibandCompressor::chunkSize - 1) / MultibandCompressor::chunkSize);
+        blockAlphaA.resize(maxBlockSize);
+        blockAlphaR.resize(maxBlockSize);
+        blockControl.resize(blockChunkSettings.size() * MultibandCompressor::chunkSize * MultibandCompressor::numLanes
+                            + dsp::SIMDRegister<float>::SIMDNumElements);
+    }
+    else {
+        workerPool.release();
+    }
 }
 
 void Ckpa_compressorAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    processSamples(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+void Ckpa_compressorAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    processSamples(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+bool Ckpa_compressorAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::processSamples(SampleType* const* channels, int numChannels, int numSamples)
 {
     ScopedNoDenormals noDenormals;
 
-    const int numInputChannels = getTotalNumInputChannels();
-    const int numOutputChannels = getTotalNumOutputChannels();
-    const int numSamples = buffer.getNumSamples();
+    const int numInputChannels = getMainBusNumInputChannels();
+    const int numOutputChannels = getMainBusNumOutputChannels();
 
-    // Create copy of buffer before compression
-    bufferBefore.makeCopyOf(buffer);
+    // Blocks longer than announced are split, the dry path and the oversamplers are sized for maxBlockSize.
+    // The slices point into the block through an array allocated in prepareToPlay
+    if (numSamples > maxBlockSize) {
+        std::vector<SampleType*>& slice = getSliceChannels(SampleType());
+        jassert(numChannels <= (int) slice.size());
 
+        for (int start = 0; start < numSamples; start += maxBlockSize) {
+            for (int channel = 0; channel < numChannels; ++channel)
+                slice[channel] = channels[channel] + start;
+            processSamples(slice.data(), numChannels, jmin(maxBlockSize, numSamples - start));
+        }
+        return;
+    }
+
+    // The message thread rebuilds the worker pool for a new Processing Threads, until then the block runs inline
+    const SpinLock::ScopedTryLockType workerPoolLocked(workerPoolLock);
+    workerPoolAvailable = workerPoolLocked.isLocked();
+    if (workerPoolAvailable && (int) paramProcessingThreads.getTargetValue() != workerPoolThreads)
+        triggerAsyncUpdate();
+
+    // The kernels accumulate the levels for the meters and the visualiser in the same pass as the compression
+    blockLevels.clear();
+    receiveChannelGroups();
+
+    DryWetMixer<SampleType>& mixer = getMixer(SampleType());
+    if (mixer.isPrepared())
+        mixer.pushDry(channels, numInputChannels, numSamples);
+
+    // Bypass runs at the host rate, a new factor or phase starts from cleared states
+    Oversamplers<SampleType>& oversamplers = getOversamplers(SampleType());
+    const bool bypass = (bool) paramBypass.getTargetValue();
+    const int stages = (bypass || !oversamplers.isPrepared()) ? 0 : (int) paramOversampling.getTargetValue();
+    const int phase = (int) paramOversamplingPhase.getTargetValue();
+
+    if (stages != oversamplingStages || (stages > 0 && phase != oversamplingPhase)) {
+        oversamplingStages = stages;
+        oversamplingPhase = phase;
+        if (stages > 0)
+            oversamplers.reset(stages, phase);
+        setProcessingRate(getSampleRate() * (1 << stages));
+    }
+
+    // The kernel is picked once per block, there is no branching on bypass or channel count inside it
+    compressorState.setRmsWindowSize(getRmsWindowSamples());
+    KernelFunction<SampleType> kernel = selectKernel<SampleType>(numInputChannels);
+
+    if (oversamplingStages == 0)
+        (this->*kernel)(channels, numSamples);
+    else
+        processOversampled(channels, numSamples, kernel);
+
+    updateLatency();
+
+    // Parallel compression, the dry samples are delayed by the latency of the wet path. Bypass delays them the same
+    const bool fullyWet = paramMix.getTargetValue() == 1.0f && !paramMix.isSmoothing();
+    if (bypass && mixer.isPrepared())
+        mixer.readDry(channels, numInputChannels, numSamples, getCurrentLatency());
+    else if (!fullyWet && mixer.isPrepared())
+        mixer.mix(channels, numInputChannels, numSamples, getCurrentLatency(),
+                  paramMix, blockLevels, (float) (1 << oversamplingStages));
+
+    // Push levels to level metersources and the waveform summary to the visualiser
+    blockLevels.pushToMeters(meterSourceInput, meterSourceOutput, meterSourceGainReduction,
+                             numSamples << oversamplingStages);
+
+    if (numInputChannels > 0) {
+        const ChannelLevels& levels = blockLevels[0];
+        signalTap.pushSummary(Range<float>(levels.inputMin, levels.inputMax),
+                              Range<float>(levels.outputMin, levels.outputMax), numSamples);
+    }
+
+    // Notify visualiser parent that buffer changed
+    sendChangeMessage();
+
+    //======================================
+
+    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
+        FloatVectorOperations::clear(channels[channel], numSamples);
+}
+
+template <typename SampleType>
+Ckpa_compressorAudioProcessor::KernelFunction<SampleType> Ckpa_compressorAudioProcessor::selectKernel(int numChannels) const
+{
     // Don't compress if bypass activated
-    if (!(bool) paramBypass.getTargetValue()) {
-        bufferGainReduction.makeCopyOf(buffer);
-
-        mixedDownInput.clear();
-        for (int channel = 0; channel < numInputChannels; ++channel)
-            mixedDownInput.addFrom(0, 0, buffer, channel, 0, numSamples, 1.0f / numInputChannels);
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            float T = paramThreshold.getNextValue();                                // Threshold
-            float R = paramRatio.getNextValue();                                    // Ratio
-            float alphaA = calculateAttackOrRelease(paramAttack.getNextValue());    // Attack
-            float alphaR = calculateAttackOrRelease(paramRelease.getNextValue());   // Release
-            float makeupGain = paramMakeupGain.getNextValue();                      // Makeup Gain
-
-            // Square input to get rid of sign
-            inputLevel = powf(mixedDownInput.getSample(0, sample), 2.0f);
-            // Convert gain to dB (10.0f instead of 20.0f since inputLevel was squared)
-            xg = (inputLevel <= 1e-6f) ? -60.0f : 10.0f * log10f(inputLevel);
-
-            // Compressor
-            if (xg < T) {   // Do nothing
-                yg = xg;
-            } else {        // Compress
-                yg = T + (xg - T) / R;
-            }
+    if ((bool) paramBypass.getTargetValue())
+        return &Ckpa_compressorAudioProcessor::bypassBlock<SampleType>;
 
-            // Difference of input and output of compression
-            xl = xg - yg;
+    if (paramMode.getTargetValue() == 1.0f)
+        return &Ckpa_compressorAudioProcessor::limitBlock<SampleType>;
 
-            if (xl > ylPrev) {  // Signal rising -> Attack
-                yl = alphaA * ylPrev + (1.0f - alphaA) * xl;
-            } else {            // Signal falling -> Release
-                yl = alphaR * ylPrev + (1.0f - alphaR) * xl;
-            }
+    if (paramMode.getTargetValue() == 2.0f)
+        return &Ckpa_compressorAudioProcessor::multibandBlock<SampleType>;
 
-            // Calculate control and convert dB to gain
-            control = powf(10.0f, (makeupGain - yl) * 0.05f);
-            ylPrev = yl;
+    // The per sample reference implementation, for comparisons with the block oriented kernels
+    if (paramProcessingKernel.getTargetValue() == 1.0f)
+        return &Ckpa_compressorAudioProcessor::compressScalar<SampleType>;
 
-            for (int channel = 0; channel < numInputChannels; ++channel) {
-                float oldValue = buffer.getSample(channel, sample);
-                float newValue = oldValue * control;
-                buffer.setSample(channel, sample, newValue);
-                float reductionValue = control < 1 ? oldValue - newValue : 0;
-                bufferGainReduction.setSample(channel, sample, reductionValue);
-            }
+    // The gate only costs anything while it has a range
+    if (paramGateRange.getTargetValue() > 0.0f)
+        return selectDetectorKernel<SampleType, GatedCurve<TableCurve>>(numChannels);
+
+    return selectDetectorKernel<SampleType, TableCurve>(numChannels);
+}
+
+template <typename SampleType, typename GainComputer>
+Ckpa_compressorAudioProcessor::KernelFunction<SampleType> Ckpa_compressorAudioProcessor::selectDetectorKernel(int numChannels) const
+{
+    // The linear detector smooths the level before it is converted to dB
+    // The RMS detectors average the squared level over the RMS window first
+    const bool rms = paramDetection.getTargetValue() == 1.0f;
+
+    if (paramDetector.getTargetValue() == 1.0f) {
+        return rms ? selectLinkKernel<SampleType, RmsDetector<LinearMixDownDetector>, GainComputer, BranchingSmoother>(numChannels)
+                   : selectLinkKernel<SampleType, LinearMixDownDetector, GainComputer, BranchingSmoother>(numChannels);
+    }
+
+    return rms ? selectLinkKernel<SampleType, RmsDetector<MixDownDetector>, GainComputer, BranchingSmoother>(numChannels)
+               : selectLinkKernel<SampleType, MixDownDetector, GainComputer, BranchingSmoother>(numChannels);
+}
+
+template <typename SampleType, typename Detector, typename GainComputer, typename Smoother>
+Ckpa_compressorAudioProcessor::KernelFunction<SampleType> Ckpa_compressorAudioProcessor::selectLinkKernel(int numChannels) const
+{
+    const bool unlinked = paramChannelLink.getTargetValue() == 1.0f;
+
+    // Mid/side needs a stereo pair, any other channel count stays left/right
+    if (paramStereoMode.getTargetValue() == 1.0f && numChannels == 2) {
+        return unlinked ? &Ckpa_compressorAudioProcessor::compressBlock<UnlinkedMidSideCompressorKernel<Detector, GainComputer, Smoother, 2>, SampleType>
+                        : &Ckpa_compressorAudioProcessor::compressBlock<MidSideCompressorKernel<Detector, GainComputer, Smoother, 2>, SampleType>;
+    }
+
+    // Each link group has its own envelope, excluded channels pass unchanged
+    if (paramLinkGroups.getTargetValue() > 0.0f)
+        return &Ckpa_compressorAudioProcessor::compressBlock<GroupedCompressorKernel<Detector, GainComputer, Smoother, 0>, SampleType>;
+
+    // Unlinked channels are compressed independently, each with its own envelope. With a link amount
+    // they share part of the envelope of the loudest channel, until the amount has ramped back to 0.
+    // The amount only applies here, linked channels share all of it anyway
+    const bool partiallyLinked = paramLinkAmount.getTargetValue() > 0.0f || paramLinkAmount.isSmoothing()
+                              || compressorState.linkAmountPrev > 0.0f;
+    if (unlinked && partiallyLinked)
+        return selectChannelKernel<SampleType, PartiallyLinkedCompressorKernel, Detector, GainComputer, Smoother>(numChannels);
+
+    if (unlinked)
+        return selectChannelKernel<SampleType, UnlinkedCompressorKernel, Detector, GainComputer, Smoother>(numChannels);
+
+    return selectChannelKernel<SampleType, CompressorKernel, Detector, GainComputer, Smoother>(numChannels);
+}
+
+template <typename SampleType, template <typename, typename, typename, int> class Kernel,
+          typename Detector, typename GainComputer, typename Smoother>
+Ckpa_compressorAudioProcessor::KernelFunction<SampleType> Ckpa_compressorAudioProcessor::selectChannelKernel(int numChannels) const
+{
+    switch (numChannels) {
+        case 1:  return &Ckpa_compressorAudioProcessor::compressBlock<Kernel<Detector, GainComputer, Smoother, 1>, SampleType>;
+        case 2:  return &Ckpa_compressorAudioProcessor::compressBlock<Kernel<Detector, GainComputer, Smoother, 2>, SampleType>;
+        default: return &Ckpa_compressorAudioProcessor::compressBlock<Kernel<Detector, GainComputer, Smoother, 0>, SampleType>;
+    }
+}
+
+Ckpa_compressorAudioProcessor::ChunkSettings Ckpa_compressorAudioProcessor::readChunkSettings(int num, float* alphaA,
+                                                                                                float* alphaR)
+{
+    // Parameters are updated once per chunk, a new curve is built on the message thread if needed
+    ChunkSettings settings;
+    settings.threshold = paramThreshold.skip(num);
+    settings.ratio = paramRatio.skip(num);
+    settings.knee = paramKnee.skip(num);
+    gainCurve.setParameters(settings.ratio, settings.knee);
+    settings.makeupGain = paramMakeupGain.skip(num);
+    settings.gateThreshold = paramGateThreshold.skip(num);
+    settings.gateRange = paramGateRange.skip(num);
+    settings.gateHysteresis = paramGateHysteresis.skip(num);
+    settings.linkAmount = paramLinkAmount.skip(num);
+
+    // Coefficients are only recomputed when attack or release changed
+    attackCoefficient.setTime(paramAttack.skip(num));
+    releaseCoefficient.setTime(paramRelease.skip(num));
+
+    settings.ramping = attackCoefficient.isSmoothing() || releaseCoefficient.isSmoothing();
+    settings.alphaA = attackCoefficient.getCurrentValue();
+    settings.alphaR = releaseCoefficient.getCurrentValue();
+
+    if (settings.ramping) {
+        for (int i = 0; i < num; ++i) {
+            alphaA[i] = attackCoefficient.getNextValue();
+            alphaR[i] = releaseCoefficient.getNextValue();
         }
     }
-    else {
-        for (int sample = 0; sample < numSamples; ++sample) {
-            for (int channel = 0; channel < numInputChannels; ++channel) {
-                bufferGainReduction.setSample(channel, sample, 0);
+
+    return settings;
+}
+
+template <>
+TableCurve Ckpa_compressorAudioProcessor::makeGainComputer<TableCurve>(const TableCurve& curve,
+                                                                       const ChunkSettings&)
+{
+    return curve;
+}
+
+template <>
+GatedCurve<TableCurve> Ckpa_compressorAudioProcessor::makeGainComputer<GatedCurve<TableCurve>>(const TableCurve& curve,
+                                                                                             const ChunkSettings& settings)
+{
+    return { curve, settings.gateThreshold, settings.gateRange, settings.gateHysteresis,
+             &compressorState.gateOpen, compressorState.channelGateOpen.data() };
+}
+
+template <typename Kernel, typename SampleType>
+void Ckpa_compressorAudioProcessor::compressBlock(SampleType* const* channels, int numSamples)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    const int numLaneGroups = Kernel::getNumLaneGroups(compressorState, numInputChannels);
+    if (canRunInParallel(numLaneGroups, numSamples)) {
+        compressLaneGroups<Kernel>(channels, numSamples, numLaneGroups);
+        return;
+    }
+
+    const int controlInterval = (int) paramControlInterval.getTargetValue();
+
+    int numSidechainChannels;
+    const SampleType* const* sidechain = getSidechain(channels, numSidechainChannels);
+
+    const SampleType* const* input = channels;
+    SampleType* const* output = channels;
+
+    float alphaA[Kernel::chunkSize];
+    float alphaR[Kernel::chunkSize];
+
+    for (int start = 0; start < numSamples; start += Kernel::chunkSize) {
+        const int num = jmin((int) Kernel::chunkSize, numSamples - start);
+
+        const DetectorInputOf<SampleType> detectorInput = getDetectorInput(input, numInputChannels, sidechain,
+                                                             numSidechainChannels, start, num);
+
+        const ChunkSettings settings = readChunkSettings(num, alphaA, alphaR);
+        compressorState.linkAmount = settings.linkAmount;
+        const TableCurve curve{ &gainCurve.acquire(), settings.threshold, settings.ratio, settings.knee };
+        const typename Kernel::GainComputerType gainComputer
+            = makeGainComputer<typename Kernel::GainComputerType>(curve, settings);
+
+        if (!settings.ramping) {
+            ConstantCoefficients coefficients{ settings.alphaA, settings.alphaR };
+            Kernel::processChunk(compressorState, output, numInputChannels, detectorInput, start, num,
+                                 gainComputer, coefficients, settings.makeupGain, controlInterval, blockLevels);
+        }
+        else {
+            Kernel::processChunk(compressorState, output, numInputChannels, detectorInput, start, num,
+                                 gainComputer, RampedCoefficients{ alphaA, alphaR }, settings.makeupGain,
+                                 controlInterval, blockLevels);
+        }
+    }
+}
+
+template <typename Kernel, typename SampleType>
+void Ckpa_compressorAudioProcessor::compressLaneGroups(SampleType* const* channels, int numSamples, int numLaneGroups)
+{
+    static_assert((int) Kernel::chunkSize == (int) MultibandCompressor::chunkSize,
+                  "the block storage is allocated for the chunks of the multiband compressor");
+    typedef typename Kernel::GainComputerType GainComputer;
+
+    const int numInputChannels = getMainBusNumInputChannels();
+    const int numChunks = (numSamples + Kernel::chunkSize - 1) / Kernel::chunkSize;
+    const int controlInterval = (int) paramControlInterval.getTargetValue();
+
+    int numSidechainChannels;
+    const SampleType* const* sidechain = getSidechain(channels, numSidechainChannels);
+
+    SampleType* const* output = channels;
+
+    // The parameters of all chunks are read first, the workers only see the results
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+        const int start = chunk * Kernel::chunkSize;
+        const int num = jmin((int) Kernel::chunkSize, numSamples - start);
+        blockChunkSettings[chunk] = readChunkSettings(num, blockAlphaA.data() + start, blockAlphaR.data() + start);
+    }
+
+    // One curve for the whole block, it mustn't be swapped while the workers read it
+    const GainCurveTable::Table* table = &gainCurve.acquire();
+
+    auto job = [&](int laneGroup) {
+        for (int chunk = 0; chunk < numChunks; ++chunk) {
+            const int start = chunk * Kernel::chunkSize;
+            const int num = jmin((int) Kernel::chunkSize, numSamples - start);
+            const ChunkSettings& settings = blockChunkSettings[chunk];
+
+            const DetectorInputOf<SampleType> detectorInput{ sidechain, numSidechainChannels, start };
+            const TableCurve curve{ table, settings.threshold, settings.ratio, settings.knee };
+            const GainComputer gainComputer = makeGainComputer<GainComputer>(curve, settings);
+
+            if (!settings.ramping) {
+                Kernel::processLaneGroup(laneGroup, compressorState, output, numInputChannels, detectorInput, start, num,
+                                         gainComputer, ConstantCoefficients{ settings.alphaA, settings.alphaR },
+                                         settings.makeupGain, controlInterval, blockLevels);
+            }
+            else {
+                const RampedCoefficients coefficients{ blockAlphaA.data() + start, blockAlphaR.data() + start };
+                Kernel::processLaneGroup(laneGroup, compressorState, output, numInputChannels, detectorInput, start, num,
+                                         gainComputer, coefficients, settings.makeupGain, controlInterval, blockLevels);
             }
         }
+    };
+    workerPool.run(numLaneGroups, job);
+}
+
+bool Ckpa_compressorAudioProcessor::canRunInParallel(int numJobs, int numSamples)
+{
+    if (!workerPoolAvailable || workerPool.getNumWorkers() == 0 || numJobs < 2 || numSamples > maxBlockSize)
+        return false;
+
+    // Only peeks at the filter parameters, the serial path advances them chunk by chunk
+    detectorFilter.setParameters(paramSidechainHighPass.getTargetValue(), paramSidechainTilt.getTargetValue());
+    if (detectorFilter.isActive())
+        return false;
+
+    // The parallel paths don't read them per chunk, they advance once for the whole block
+    paramSidechainHighPass.skip(numSamples);
+    paramSidechainTilt.skip(numSamples);
+    return true;
+}
+
+template <typename SampleType>
+DetectorInputOf<SampleType> Ckpa_compressorAudioProcessor::getDetectorInput(const SampleType* const* input,
+                                                                            int numInputChannels,
+                                                                            const SampleType* const* sidechain,
+                                                                            int numSidechainChannels, int start, int num)
+{
+    // The detector reads the sidechain or the main input, through the filter if it is on
+    detectorFilter.setParameters(paramSidechainHighPass.skip(num), paramSidechainTilt.skip(num));
+    if (!detectorFilter.isActive())
+        return { sidechain, numSidechainChannels, start };
+
+    return (sidechain != nullptr) ? detectorFilter.process(sidechain, numSidechainChannels, start, num)
+                                  : detectorFilter.process(input, numInputChannels, start, num);
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::multibandBlock(SampleType* const* channels, int numSamples)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    int numSidechainChannels;
+    const SampleType* const* sidechain = getSidechain(channels, numSidechainChannels);
+
+    const SampleType* const* input = channels;
+    SampleType* const* output = channels;
+
+    // Once per block, so every chunk and channel group sees the same crossovers and bands
+    setMultibandParameters(numSamples);
+
+    // The linked control gains of every chunk first, then the channel groups split the block
+    const int numGroups = MultibandCompressor::getNumGroups(numInputChannels);
+    if (canRunInParallel(numGroups, numSamples)) {
+        const int numChunks = (numSamples + MultibandCompressor::chunkSize - 1) / MultibandCompressor::chunkSize;
+        const int controlSize = MultibandCompressor::chunkSize * MultibandCompressor::numLanes;
+        float* const control = dsp::SIMDRegister<float>::getNextSIMDAlignedPtr(blockControl.data());
+
+        for (int chunk = 0; chunk < numChunks; ++chunk) {
+            const int start = chunk * MultibandCompressor::chunkSize;
+            const int num = jmin((int) MultibandCompressor::chunkSize, numSamples - start);
+
+            const DetectorInputOf<SampleType> detectorInput{ sidechain, numSidechainChannels, start };
+            multiband.computeChunkControl(input, numInputChannels, detectorInput, start, num,
+                                          control + chunk * controlSize);
+        }
+
+        auto job = [&](int group) {
+            for (int chunk = 0; chunk < numChunks; ++chunk) {
+                const int start = chunk * MultibandCompressor::chunkSize;
+                const int num = jmin((int) MultibandCompressor::chunkSize, numSamples - start);
+                multiband.processGroup(group, output, numInputChannels, start, num,
+                                       control + chunk * controlSize, blockLevels);
+            }
+        };
+        workerPool.run(numGroups, job);
+        return;
     }
 
-    // Create copy of buffer after compression
-    bufferAfter.makeCopyOf(buffer);
+    for (int start = 0; start < numSamples; start += MultibandCompressor::chunkSize) {
+        const int num = jmin((int) MultibandCompressor::chunkSize, numSamples - start);
 
-    // Push signal to level metersources
-    meterSourceInput.measureBlock(bufferBefore);
-    meterSourceOutput.measureBlock(buffer);
-    meterSourceGainReduction.measureBlock(bufferGainReduction);
+        const DetectorInputOf<SampleType> detectorInput = getDetectorInput(input, numInputChannels, sidechain,
+                                                             numSidechainChannels, start, num);
 
-    // Notify visualiser parent that buffer changed
-    sendChangeMessage();
+        multiband.process(output, numInputChannels, detectorInput, start, num, blockLevels);
+    }
+}
 
-    //======================================
+void Ckpa_compressorAudioProcessor::setMultibandParameters(int numSamples)
+{
+    // The makeup gain applies to all bands, the knee is shared
+    const float knee = paramKnee.skip(numSamples);
+    const float makeupGain = paramMakeupGain.skip(numSamples);
 
-    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
-        buffer.clear(channel, 0, numSamples);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band) {
+        PluginParameterBand& parameters = *paramBands[band];
+        multiband.setBand(band, { parameters.threshold.skip(numSamples), parameters.ratio.skip(numSamples),
+                                  parameters.attack.skip(numSamples), parameters.release.skip(numSamples),
+                                  parameters.gain.skip(numSamples) + makeupGain }, knee);
+    }
+
+    // The crossover ranges overlap, each frequency is kept above the one below it and below Nyquist
+    const float maxFrequency = 0.45f * (float) processingRate;
+    float frequencies[MultibandCompressor::maxBands - 1];
+    frequencies[0] = jmin(paramCrossover1.skip(numSamples), maxFrequency);
+    frequencies[1] = jlimit(frequencies[0], maxFrequency, paramCrossover2.skip(numSamples));
+    frequencies[2] = jlimit(frequencies[1], maxFrequency, paramCrossover3.skip(numSamples));
+
+    multiband.setCrossovers((int) paramNumBands.skip(numSamples), frequencies);
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::compressScalar(SampleType* const* channels, int numSamples)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    // The detector reads the sidechain if it is active, the main input otherwise
+    int numDetectorChannels;
+    const SampleType* const* detectorChannels = getSidechain(channels, numDetectorChannels);
+    if (detectorChannels == nullptr) {
+        detectorChannels = channels;
+        numDetectorChannels = numInputChannels;
+    }
+    DetectorInputOf<SampleType> detectorInput{ detectorChannels, numDetectorChannels, 0 };
+    const bool rms = paramDetection.getTargetValue() == 1.0f;
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        // The detector filter runs a chunk ahead, the detector input starts at chunkStart
+        const int chunkStart = sample - sample % DetectorFilter::chunkSize;
+        if (sample == chunkStart) {
+            const int num = jmin((int) DetectorFilter::chunkSize, numSamples - sample);
+            detectorFilter.setParameters(paramSidechainHighPass.skip(num), paramSidechainTilt.skip(num));
+            detectorInput = detectorFilter.isActive()
+                ? detectorFilter.process(detectorChannels, numDetectorChannels, chunkStart, num)
+                : DetectorInputOf<SampleType>{ detectorChannels, numDetectorChannels, chunkStart };
+        }
+
+        float T = paramThreshold.getNextValue();                                // Threshold
+        float R = paramRatio.getNextValue();                                    // Ratio
+        float alphaA = calculateAttackOrRelease(paramAttack.getNextValue());    // Attack
+        float alphaR = calculateAttackOrRelease(paramRelease.getNextValue());   // Release
+        float makeupGain = paramMakeupGain.getNextValue();                      // Makeup Gain
+        float K = paramKnee.getNextValue();                                     // Knee
+        float gateT = paramGateThreshold.getNextValue();                        // Gate Threshold
+        float gateRange = paramGateRange.getNextValue();                        // Gate Range
+        float gateH = paramGateHysteresis.getNextValue();                       // Gate Hysteresis
+
+        // Mix down input
+        float mixedDownInput = 0.0f;
+        for (int channel = 0; channel < numDetectorChannels; ++channel)
+            mixedDownInput += (float) detectorInput.channels[channel][detectorInput.start + sample - chunkStart]
+                              * (1.0f / numDetectorChannels);
+
+        // Square input to get rid of sign
+        float inputLevel = powf(mixedDownInput, 2.0f);
+        if (rms)
+            compressorState.rmsWindow.process(&inputLevel, 1);
+        // Convert gain to dB (10.0f instead of 20.0f since inputLevel was squared)
+        const float xg = (inputLevel <= 1e-6f) ? -60.0f : 10.0f * log10f(inputLevel);
+
+        // Compressor, difference of input and output of compression
+        float xl = GainCurveTable::computeReduction(xg, T, R, K);
+
+        // Gate, opens above its threshold and only closes again below threshold - hysteresis
+        if (gateRange > 0.0f) {
+            const bool wasOpen = compressorState.gateOpen > 0.0f;
+            compressorState.gateOpen = xg > (wasOpen ? gateT - gateH : gateT) ? 1.0f : 0.0f;
+            xl += (1.0f - compressorState.gateOpen) * gateRange;
+        }
+
+        // The envelope state is double, so long releases don't accumulate rounding errors
+        if (xl > compressorState.ylPrev) {   // Signal rising -> Attack
+            compressorState.ylPrev = alphaA * compressorState.ylPrev + (1.0 - alphaA) * xl;
+        } else {                    // Signal falling -> Release
+            compressorState.ylPrev = alphaR * compressorState.ylPrev + (1.0 - alphaR) * xl;
+        }
+        const float yl = (float) compressorState.ylPrev;
+
+        // Calculate control and convert dB to gain
+        const float control = powf(10.0f, (makeupGain - yl) * 0.05f);
+
+        for (int channel = 0; channel < numInputChannels; ++channel) {
+            const SampleType output = channels[channel][sample] * (SampleType) control;
+            float oldValue = (float) channels[channel][sample];
+            float newValue = (float) output;
+            channels[channel][sample] = output;
+            float reductionValue = control < 1 ? oldValue - newValue : 0;
+
+            ChannelLevels& levels = blockLevels[channel];
+            levels.inputMin = jmin(levels.inputMin, oldValue);
+            levels.inputMax = jmax(levels.inputMax, oldValue);
+            levels.inputSquares += oldValue * oldValue;
+            levels.outputMin = jmin(levels.outputMin, newValue);
+            levels.outputMax = jmax(levels.outputMax, newValue);
+            levels.outputSquares += newValue * newValue;
+            levels.reductionPeak = jmax(levels.reductionPeak, std::abs(reductionValue));
+            levels.reductionSquares += reductionValue * reductionValue;
+        }
+    }
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::limitBlock(SampleType* const* channels, int numSamples)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    // A new lookahead fades through cleared delay lines, the new latency is reported after the block
+    const int lookahead = getLookaheadSamples();
+    if (lookahead != limiter.getLookahead())
+        limiter.changeLookahead(lookahead);
+
+    for (int start = 0; start < numSamples; start += LookaheadLimiter::chunkSize) {
+        const int num = jmin((int) LookaheadLimiter::chunkSize, numSamples - start);
+
+        // The threshold is the ceiling, attack and ratio don't apply
+        const float ceiling = FastMath::decibelsToGain(paramThreshold.skip(num));
+        const float makeupGain = FastMath::decibelsToGain(paramMakeupGain.skip(num));
+        releaseCoefficient.setTime(paramRelease.skip(num));
+
+        limiter.process(channels, numInputChannels, start, num, ceiling, releaseCoefficient.skip(num),
+                        makeupGain, blockLevels);
+    }
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::bypassBlock(SampleType* const* channels, int numSamples)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    for (int channel = 0; channel < numInputChannels; ++channel) {
+        ChannelLevels& levels = blockLevels[channel];
+        BlockLevels::measure(channels[channel], numSamples, levels.inputMin, levels.inputMax, levels.inputSquares);
+        levels.outputMin = levels.inputMin;
+        levels.outputMax = levels.inputMax;
+        levels.outputSquares = levels.inputSquares;
+    }
+}
+
+template <typename SampleType>
+void Ckpa_compressorAudioProcessor::processOversampled(SampleType* const* channels, int numSamples,
+                                                       KernelFunction<SampleType> kernel)
+{
+    const int numInputChannels = getMainBusNumInputChannels();
+
+    Oversamplers<SampleType>& oversamplers = getOversamplers(SampleType());
+    const int numChannels = (int) oversamplers.channels.size();
+    dsp::Oversampling<SampleType>& oversampler = oversamplers.get(oversamplingStages, oversamplingPhase);
+    const int padding = oversamplers.getPadding(oversamplingStages, oversamplingPhase);
+    dsp::AudioBlock<SampleType> block(channels, (size_t) numChannels, (size_t) numSamples);
+
+    for (int start = 0; start < numSamples; start += maxBlockSize) {
+        const int num = jmin(maxBlockSize, numSamples - start);
+        dsp::AudioBlock<SampleType> slice = block.getSubBlock((size_t) start, (size_t) num);
+
+        // The kernels see the same channel layout, with the sidechain channels in the same place
+        dsp::AudioBlock<SampleType> oversampledBlock = oversampler.processSamplesUp(slice);
+        const int numOversampled = (int) oversampledBlock.getNumSamples();
+        for (int channel = 0; channel < numChannels; ++channel)
+            oversamplers.channels[channel] = oversampledBlock.getChannelPointer((size_t) channel);
+
+        (this->*kernel)(oversamplers.channels.data(), numOversampled);
+        if (padding > 0)
+            oversamplers.pad(oversamplers.channels.data(), numInputChannels, numOversampled, padding);
+        oversampler.processSamplesDown(slice);
+    }
+}
+
+void Ckpa_compressorAudioProcessor::setProcessingRate(double newProcessingRate)
+{
+    const double smoothTime = 1e-3;
+
+    processingRate = newProcessingRate;
+    inverseSampleRate = 1.0f / (float) processingRate;
+
+    // The kernels advance these per processed sample, so their ramps keep their length when oversampling.
+    // The rest is read once per block or, like the mix, at the host rate and is reset in prepareToPlay
+    paramThreshold.reset(processingRate, smoothTime);
+    paramRatio.reset(processingRate, smoothTime);
+    paramAttack.reset(processingRate, smoothTime);
+    paramRelease.reset(processingRate, smoothTime);
+    paramMakeupGain.reset(processingRate, smoothTime);
+    paramKnee.reset(processingRate, smoothTime);
+    paramSidechainHighPass.reset(processingRate, smoothTime);
+    paramSidechainTilt.reset(processingRate, smoothTime);
+    paramNumBands.reset(processingRate, smoothTime);
+    paramCrossover1.reset(processingRate, smoothTime);
+    paramCrossover2.reset(processingRate, smoothTime);
+    paramCrossover3.reset(processingRate, smoothTime);
+    paramGateThreshold.reset(processingRate, smoothTime);
+    paramGateRange.reset(processingRate, smoothTime);
+    paramGateHysteresis.reset(processingRate, smoothTime);
+    paramLinkAmount.reset(processingRate, 0.05);
+    for (PluginParameterBand* band : paramBands)
+        band->reset(processingRate, smoothTime);
+
+    attackCoefficient.reset(processingRate, smoothTime);
+    releaseCoefficient.reset(processingRate, smoothTime);
+    detectorFilter.setSampleRate(processingRate);
+    multiband.setSampleRate(processingRate, smoothTime);
+
+    compressorState.setRmsWindowSize(getRmsWindowSamples());
+    limiter.setLookahead(getLookaheadSamples());
+}
+
+template <typename SampleType>
+const SampleType* const* Ckpa_compressorAudioProcessor::getSidechain(const SampleType* const* channels, int& numChannels) const
+{
+    // A disabled or missing bus has no channels
+    numChannels = getChannelCountOfBus(true, 1);
+    if (numChannels == 0)
+        return nullptr;
+
+    // The sidechain channels follow the main input channels in the buffer, nothing is copied
+    return channels + getChannelIndexInProcessBlockBuffer(true, 1, 0);
+}
+
+int Ckpa_compressorAudioProcessor::getRmsWindowSamples() const
+{
+    return jmax(1, roundToInt(paramRmsWindow.getTargetValue() * processingRate));
+}
+
+int Ckpa_compressorAudioProcessor::getLookaheadSamples() const
+{
+    // Whole samples at the host rate, so the reported latency is exact at any factor
+    const int lookahead = roundToInt(paramLookahead.getTargetValue() * getSampleRate()) << oversamplingStages;
+    return jmin(lookahead, limiter.getMaxLookahead());
+}
+
+int Ckpa_compressorAudioProcessor::getCurrentLatency() const
+{
+    // The limiter delays the signal by its lookahead, the oversampling filters by their group delay.
+    // Bypass runs at the host rate without the limiter, it takes both from the parameters
+    if ((bool) paramBypass.getTargetValue()) {
+        const int lookahead = roundToInt(paramLookahead.getTargetValue() * getSampleRate());
+        return getOversamplingLatency((int) paramOversampling.getTargetValue(), (int) paramOversamplingPhase.getTargetValue())
+             + (paramMode.getTargetValue() == 1.0f ? lookahead : 0);
+    }
+
+    const bool limiting = paramMode.getTargetValue() == 1.0f;
+    return getOversamplingLatency(oversamplingStages, oversamplingPhase)
+         + (limiting ? (limiter.getLookahead() >> oversamplingStages) : 0);
+}
+
+int Ckpa_compressorAudioProcessor::getOversamplingLatency(int stages, int phase) const
+{
+    // Only the oversamplers of the precision the host uses are prepared
+    if (stages == 0)
+        return 0;
+
+    if (isUsingDoublePrecision())
+        return doubleOversamplers.isPrepared() ? doubleOversamplers.getLatency(stages, phase) : 0;
+
+    return floatOversamplers.isPrepared() ? floatOversamplers.getLatency(stages, phase) : 0;
+}
+
+void Ckpa_compressorAudioProcessor::updateLatency()
+{
+    const int latency = getCurrentLatency();
+
+    if (latency != requiredLatency.load(std::memory_order_relaxed)) {
+        requiredLatency.store(latency, std::memory_order_relaxed);
+        triggerAsyncUpdate();
+    }
+}
+
+void Ckpa_compressorAudioProcessor::handleAsyncUpdate()
+{
+    setLatencySamples(requiredLatency.load(std::memory_order_relaxed));
+
+    if ((int) paramProcessingThreads.getTargetValue() != workerPoolThreads)
+        prepareWorkerPool();
 }
 
 float Ckpa_compressorAudioProcessor::calculateAttackOrRelease(float value)
@@ -216,6 +955,69 @@ void Ckpa_compressorAudioProcessor::setStateInformation(const void* data, int si
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName(parameters.valueTreeState.state.getType()))
             parameters.valueTreeState.replaceState(ValueTree::fromXml(*xmlState));
+
+    updateChannelGroups();
+}
+
+//==============================================================================
+
+static const Identifier linkGroupsProperty("LinkGroups");
+
+void Ckpa_compressorAudioProcessor::setLinkGroups(const String& definition)
+{
+    parameters.valueTreeState.state.setProperty(linkGroupsProperty, definition, nullptr);
+    updateChannelGroups();
+}
+
+String Ckpa_compressorAudioProcessor::getLinkGroups() const
+{
+    return parameters.valueTreeState.state.getProperty(linkGroupsProperty).toString();
+}
+
+bool Ckpa_compressorAudioProcessor::isLinkAmountActive() const
+{
+    // The conditions under which selectLinkKernel() picks the partially linked kernel
+    const bool midSide = paramStereoMode.getTargetValue() == 1.0f && getMainBusNumInputChannels() == 2;
+    return paramMode.getTargetValue() == 0.0f && paramProcessingKernel.getTargetValue() == 0.0f
+        && paramChannelLink.getTargetValue() == 1.0f && paramLinkGroups.getTargetValue() == 0.0f && !midSide;
+}
+
+void Ckpa_compressorAudioProcessor::updateChannelGroups()
+{
+    const AudioChannelSet layout = getChannelLayoutOfBus(true, 0);
+
+    // Every choice of Link Groups is built here, the audio thread only picks one
+    ChannelGroups choices[numLinkGroupChoices];
+    if (!choices[0].fromString(getLinkGroups()) || choices[0].getNumChannels() != layout.size())
+        choices[0] = ChannelGroups::fromLayout(layout);
+
+    const ChannelGroups::Preset presets[] = { ChannelGroups::layoutPairs, ChannelGroups::frontsLinked,
+                                              ChannelGroups::allLinked, ChannelGroups::independent };
+    for (int preset = 0; preset < numLinkGroupChoices - 1; ++preset)
+        choices[preset + 1] = ChannelGroups::fromLayout(layout, presets[preset]);
+
+    const SpinLock::ScopedLockType lock(channelGroupsLock);
+    std::copy(choices, choices + numLinkGroupChoices, pendingChannelGroups);
+    channelGroupsChanged = true;
+}
+
+void Ckpa_compressorAudioProcessor::receiveChannelGroups()
+{
+    if (channelGroupsChanged) {
+        const SpinLock::ScopedTryLockType lock(channelGroupsLock);
+        if (lock.isLocked()) {
+            std::copy(pendingChannelGroups, pendingChannelGroups + numLinkGroupChoices, linkGroupChoices);
+            channelGroupsChanged = false;
+            linkGroupChoice = -1;
+        }
+    }
+
+    // Link Groups is Off at 0, the choices start at Custom
+    const int choice = (int) paramLinkGroups.getTargetValue() - 1;
+    if (choice >= 0 && choice != linkGroupChoice) {
+        compressorState.channelGroups = linkGroupChoices[choice];
+        linkGroupChoice = choice;
+    }
 }
 
 //==============================================================================
@@ -239,16 +1041,22 @@ bool Ckpa_compressorAudioProcessor::isBusesLayoutSupported(const BusesLayout& la
     ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Any layout up to maxChannels is fine, the kernels treat the channels as discrete
+    const int numOutputChannels = layouts.getMainOutputChannelSet().size();
+    if (numOutputChannels < 1 || numOutputChannels > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
 #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain is optional, it can be off or any layout up to maxChannels
+    if (layouts.inputBuses.size() > 1) {
+        const AudioChannelSet sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled() && sidechain.size() > maxChannels)
+            return false;
+    }
 #endif
 
     return true;
@@ -27,11 +27,20 @@
 
 #include <JuceHeader.h>
 #include "PluginParameters.h"
+#include "CompressorKernel.h"
+#include "GainCurveTable.h"
+#include "LookaheadLimiter.h"
+#include "DetectorFilter.h"
+#include "Multiband.h"
+#include "DryWetMixer.h"
+#include "SignalTap.h"
+#include "WorkerPool.h"
 
 //==============================================================================
 
 class Ckpa_compressorAudioProcessor  : public AudioProcessor,
-                                       public ChangeBroadcaster
+                                       public ChangeBroadcaster,
+                                       private AsyncUpdater
 {
 public:
     //==============================================================================
@@ -49,6 +58,8 @@ public:
    #endif
 
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
     float calculateAttackOrRelease(float value);
     void showBubbleMessage(Slider* slider, Component* popupParent, bool dragMe = false, int timeout = 300);
 
@@ -79,23 +90,37 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    //==============================================================================
+    /**
+        Link groups of the main bus in the format of ChannelGroups::fromString(),
+        used while Link Groups is Custom. They are saved with the state, an empty or
+        unfitting definition falls back to the defaults of the layout.
+        Call from the message thread.
+    */
+    void setLinkGroups(const String& definition);
+    String getLinkGroups() const;
+
+    /**
+        Link Amount only blends the envelopes of unlinked channels: in compressor mode,
+        with Channel Link Unlinked, Link Groups Off and not in mid/side. The editor
+        greys it out otherwise.
+    */
+    bool isLinkAmountActive() const;
 
-    AudioBuffer<float> mixedDownInput;
-    AudioBuffer<float> bufferBefore;
-    AudioBuffer<float> bufferAfter;
-    AudioBuffer<float> bufferGainReduction;
+    //==============================================================================
 
-    float xl;
-    float yl;
-    float xg;
-    float yg;
-    float control;
+    BlockLevels blockLevels;
+    SignalTap signalTap;
 
-    float inputLevel;
-    float ylPrev;
+    CompressorState compressorState;
+    EnvelopeCoefficient attackCoefficient;
+    EnvelopeCoefficient releaseCoefficient;
+    GainCurveTable gainCurve;
+    LookaheadLimiter limiter;
+    DetectorFilter detectorFilter;
+    MultibandCompressor multiband;
 
     float inverseSampleRate;
+    double processingRate;  // sample rate of the kernels, higher than the host rate while oversampling
     float inverseE;
 
     //======================================
@@ -109,6 +134,32 @@ public:
     PluginParameterLinSlider paramMakeupGain;
     PluginParameterToggle paramBypass;
     PluginParameterLinSlider paramCompression;
+    PluginParameterComboBox paramControlInterval;
+    PluginParameterLinSlider paramKnee;
+    PluginParameterComboBox paramDetector;
+    PluginParameterComboBox paramChannelLink;
+    PluginParameterComboBox paramMode;
+    PluginParameterLinSlider paramLookahead;
+    PluginParameterLogSlider paramSidechainHighPass;
+    PluginParameterLinSlider paramSidechainTilt;
+    PluginParameterComboBox paramNumBands;
+    PluginParameterLogSlider paramCrossover1;
+    PluginParameterLogSlider paramCrossover2;
+    PluginParameterLogSlider paramCrossover3;
+    OwnedArray<PluginParameterBand> paramBands;
+    PluginParameterComboBox paramDetection;
+    PluginParameterLinSlider paramRmsWindow;
+    PluginParameterComboBox paramOversampling;
+    PluginParameterComboBox paramOversamplingPhase;
+    PluginParameterComboBox paramStereoMode;
+    PluginParameterLinSlider paramMix;
+    PluginParameterLinSlider paramGateThreshold;
+    PluginParameterLinSlider paramGateRange;
+    PluginParameterLinSlider paramGateHysteresis;
+    PluginParameterComboBox paramLinkGroups;
+    PluginParameterComboBox paramProcessingThreads;
+    PluginParameterLinSlider paramLinkAmount;
+    PluginParameterComboBox paramProcessingKernel;     // "Scalar" runs the per sample reference, not automatable
 
     foleys::LevelMeterSource meterSourceInput;
     foleys::LevelMeterSource meterSourceOutput;
@@ -117,6 +168,263 @@ public:
     std::unique_ptr<BubbleMessageComponent> popupDisplay;
 
 private:
+    template <typename SampleType>
+    using KernelFunction = void (Ckpa_compressorAudioProcessor::*)(SampleType* const*, int);
+
+    /**
+        Both processBlock() overloads share this, the DSP is the same in float and double.
+        Everything below works on arrays of channel pointers, an AudioBuffer over more
+        channels than it preallocates would allocate on the audio thread.
+    */
+    template <typename SampleType>
+    void processSamples(SampleType* const* channels, int numChannels, int numSamples);
+
+    template <typename SampleType>
+    KernelFunction<SampleType> selectKernel(int numChannels) const;
+    template <typename SampleType, typename GainComputer>
+    KernelFunction<SampleType> selectDetectorKernel(int numChannels) const;
+    template <typename SampleType, typename Detector, typename GainComputer, typename Smoother>
+    KernelFunction<SampleType> selectLinkKernel(int numChannels) const;
+    template <typename SampleType, template <typename, typename, typename, int> class Kernel,
+              typename Detector, typename GainComputer, typename Smoother>
+    KernelFunction<SampleType> selectChannelKernel(int numChannels) const;
+
+    /** Parameters of one chunk of the compressor kernels, read on the audio thread in chunk order. */
+    struct ChunkSettings
+    {
+        float threshold, ratio, knee, makeupGain;
+        float gateThreshold, gateRange, gateHysteresis;
+        float linkAmount;       // at the end of the chunk, the partially linked kernel ramps to it
+        bool ramping;           // attack or release are moving, the coefficients are in the arrays
+        float alphaA, alphaR;   // the constant coefficients otherwise
+    };
+
+    /** Advances the parameters by one chunk, the ramped coefficients are written to alphaA and alphaR. */
+    ChunkSettings readChunkSettings(int num, float* alphaA, float* alphaR);
+
+    /** The gain computer policy of the kernels around the compressor curve, with the gate parameters if it has any. */
+    template <typename GainComputer>
+    GainComputer makeGainComputer(const TableCurve& curve, const ChunkSettings& settings);
+
+    template <typename Kernel, typename SampleType>
+    void compressBlock(SampleType* const* channels, int numSamples);
+    /** Splits the lane groups of the whole block over the worker pool. */
+    template <typename Kernel, typename SampleType>
+    void compressLaneGroups(SampleType* const* channels, int numSamples, int numLaneGroups);
+    template <typename SampleType>
+    void compressScalar(SampleType* const* channels, int numSamples);
+    template <typename SampleType>
+    void limitBlock(SampleType* const* channels, int numSamples);
+    template <typename SampleType>
+    void multibandBlock(SampleType* const* channels, int numSamples);
+    template <typename SampleType>
+    void bypassBlock(SampleType* const* channels, int numSamples);
+
+    /** Runs the kernel on the upsampled buffer, in slices of at most the prepared block size. */
+    template <typename SampleType>
+    void processOversampled(SampleType* const* channels, int numSamples, KernelFunction<SampleType> kernel);
+
+    /** Moves all rate dependent state to the new processing rate, doesn't allocate. */
+    void setProcessingRate(double newProcessingRate);
+
+    /** Read pointers of the sidechain channels among the block's channels, nullptr if the sidechain is off. */
+    template <typename SampleType>
+    const SampleType* const* getSidechain(const SampleType* const* channels, int& numChannels) const;
+
+    /** Sidechain or main input for the detector, filtered by the detector filter if it is on. */
+    template <typename SampleType>
+    DetectorInputOf<SampleType> getDetectorInput(const SampleType* const* input, int numInputChannels,
+                                                 const SampleType* const* sidechain, int numSidechainChannels,
+                                                 int start, int num);
+
+    /** Passes the band and crossover parameters to the multiband compressor, advanced by numSamples. */
+    void setMultibandParameters(int numSamples);
+
+    /**
+        Whether numJobs independent groups of this block can go to the worker pool.
+        The detector filter runs chunk by chunk on the audio thread, while it is
+        on everything stays inline.
+    */
+    bool canRunInParallel(int numJobs, int numSamples);
+
+    int getRmsWindowSamples() const;
+    int getLookaheadSamples() const;
+    /**
+        Latency of the wet path in whole samples at the host rate. Bypass reports the
+        latency of the wet path it stands in for and delays the dry signal to match,
+        so toggling it doesn't move the track.
+    */
+    int getCurrentLatency() const;
+    int getOversamplingLatency(int stages, int phase) const;
+    void updateLatency();
+    void handleAsyncUpdate() override;
+
+    // Latency the host should know about, it is reported from the message thread
+    std::atomic<int> requiredLatency{ 0 };
+
+    enum { maxOversamplingStages = 2 };
+
+    // Widest main and sidechain layout
+    enum { maxChannels = ChannelGroups::maxChannels };
+
+    // Custom and the presets of Link Groups
+    enum { numLinkGroupChoices = 5 };
+
+    /**
+        Builds the groups of every choice of Link Groups for the bus. Custom parses the
+        link groups of the state, the layout defaults if there are none that fit the bus.
+    */
+    void updateChannelGroups();
+    /** Takes over new link groups and the current choice on the audio thread, if the message thread isn't writing them. */
+    void receiveChannelGroups();
+
+    SpinLock channelGroupsLock;
+    ChannelGroups pendingChannelGroups[numLinkGroupChoices];
+    std::atomic<bool> channelGroupsChanged{ false };
+
+    // Audio thread copies, linkGroupChoice is the one in compressorState
+    ChannelGroups linkGroupChoices[numLinkGroupChoices];
+    int linkGroupChoice = -1;
+
+    /**
+        One oversampler per factor and phase and the channels the kernels see, for one sample type.
+
+        The oversampling filters delay by a fraction of a sample at the host rate,
+        which the dry path of a parallel mix can't follow. The oversampled signal is
+        delayed by the padding that rounds the latency up to whole samples. That is
+        exact for the FIR filters, whose latency is a whole number of oversampled
+        samples. The IIR filters keep up to half an oversampled sample.
+    */
+    template <typename SampleType>
+    struct Oversamplers
+    {
+        /** Builds all oversamplers, call from prepareToPlay. */
+        void prepare(int numChannels, int maxBlockSize)
+        {
+            oversamplers.clear();
+
+            for (int stages = 1; stages <= maxOversamplingStages; ++stages) {
+                oversamplers.add(new dsp::Oversampling<SampleType>((size_t) numChannels, (size_t) stages,
+                                                                   dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple, true));
+                oversamplers.add(new dsp::Oversampling<SampleType>((size_t) numChannels, (size_t) stages,
+                                                                   dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR, true));
+            }
+
+            for (dsp::Oversampling<SampleType>* oversampler : oversamplers)
+                oversampler->initProcessing((size_t) maxBlockSize);
+
+            channels.assign(numChannels, nullptr);
+            history.assign(numChannels * maxPadding, 0);
+        }
+
+        void release()
+        {
+            oversamplers.clear();
+            channels.clear();
+            history.clear();
+        }
+
+        /** Clears one oversampler and the padding before it starts. */
+        void reset(int stages, int phase)
+        {
+            get(stages, phase).reset();
+            std::fill(history.begin(), history.end(), (SampleType) 0);
+        }
+
+        bool isPrepared() const { return oversamplers.size() > 0; }
+
+        /** Latency of the slowest oversampler in whole samples, rounded up. */
+        int getMaxLatency() const
+        {
+            float latency = 0.0f;
+            for (dsp::Oversampling<SampleType>* oversampler : oversamplers)
+                latency = jmax(latency, (float) oversampler->getLatencyInSamples());
+
+            return (int) std::ceil(latency);
+        }
+
+        /** Latency of one oversampler with its padding, in whole samples at the host rate. */
+        int getLatency(int stages, int phase) const
+        {
+            return (int) std::ceil(get(stages, phase).getLatencyInSamples() - latencyTolerance);
+        }
+
+        /** Oversampled samples between the latency of one oversampler and getLatency(). */
+        int getPadding(int stages, int phase) const
+        {
+            const double latency = (double) get(stages, phase).getLatencyInSamples();
+            return jlimit(0, maxPadding - 1, roundToInt((getLatency(stages, phase) - latency) * (1 << stages)));
+        }
+
+        /** Delays the first numChannels channels of an oversampled block by padding samples, in place. */
+        void pad(SampleType* const* data, int numChannels, int num, int padding)
+        {
+            jassert(padding < num && numChannels <= (int) channels.size());
+
+            SampleType last[maxPadding];
+
+            for (int channel = 0; channel < numChannels; ++channel) {
+                SampleType* line = &history[(size_t) (channel * maxPadding)];
+                std::copy(data[channel] + num - padding, data[channel] + num, last);
+                std::copy_backward(data[channel], data[channel] + num - padding, data[channel] + num);
+                std::copy(line, line + padding, data[channel]);
+                std::copy(last, last + padding, line);
+            }
+        }
+
+        dsp::Oversampling<SampleType>& get(int stages, int phase) const
+        {
+            jassert(stages > 0);
+            return *oversamplers[(stages - 1) * 2 + phase];
+        }
+
+        enum { maxPadding = 1 << maxOversamplingStages };
+        static constexpr double latencyTolerance = 1e-4;  // float rounding of a whole latency
+
+        OwnedArray<dsp::Oversampling<SampleType>> oversamplers;
+        std::vector<SampleType*> channels;
+        std::vector<SampleType> history;  // the last padding samples of every channel
+    };
+
+    // Only the oversamplers of the precision the host uses are built
+    Oversamplers<float> floatOversamplers;
+    Oversamplers<double> doubleOversamplers;
+    Oversamplers<float>& getOversamplers(float) { return floatOversamplers; }
+    Oversamplers<double>& getOversamplers(double) { return doubleOversamplers; }
+
+    int oversamplingStages = 0, oversamplingPhase = 0;
+    int maxBlockSize = 0;
+
+    // Channel pointers of the slices of blocks longer than maxBlockSize
+    std::vector<float*> floatSliceChannels;
+    std::vector<double*> doubleSliceChannels;
+    std::vector<float*>& getSliceChannels(float) { return floatSliceChannels; }
+    std::vector<double*>& getSliceChannels(double) { return doubleSliceChannels; }
+
+    // The dry path of the precision the host uses
+    DryWetMixer<float> floatMixer;
+    DryWetMixer<double> doubleMixer;
+    DryWetMixer<float>& getMixer(float) { return floatMixer; }
+    DryWetMixer<double>& getMixer(double) { return doubleMixer; }
+
+    // Helpers for independent channel and band groups, started if Processing Threads is above 1
+    WorkerPool workerPool;
+
+    /**
+        Starts the workers for Processing Threads and sizes the block storage, from
+        prepareToPlay and again on the message thread when the parameter changes.
+        Holds workerPoolLock meanwhile.
+    */
+    void prepareWorkerPool();
+
+    SpinLock workerPoolLock;        // held by the audio thread for each block and while the pool is rebuilt
+    int workerPoolThreads = 0;      // the Processing Threads the pool was prepared for
+    bool workerPoolAvailable = false;  // the audio thread holds workerPoolLock for the current block
+
+    // Per block storage of the parallel paths, the parameters of every chunk are read before the workers start
+    std::vector<ChunkSettings> blockChunkSettings;
+    std::vector<float> blockAlphaA, blockAlphaR;
+    std::vector<float> blockControl;
 
     //==============================================================================
 
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Hands the signal before and after compression from the audio thread to the GUI.
+    Only a compact summary is published, the range of the first channel before
+    and after compression for every block, so the audio thread copies nothing.
+    There is no full resolution path: the Visualiser only draws summaries, and
+    a fifo of the whole signal would have to be resized or reset while the
+    audio thread writes to it.
+*/
+class SignalTap
+{
+public:
+    enum { summaryCapacity = 2048 };
+
+    struct Summary
+    {
+        Range<float> before;
+        Range<float> after;
+        int numSamples;
+    };
+
+    SignalTap() : summaryFifo(summaryCapacity), summaries(summaryCapacity)
+    {
+    }
+
+    //============================== Audio thread ==============================
+
+    void pushSummary(Range<float> before, Range<float> after, int numSamples)
+    {
+        int start1, size1, start2, size2;
+        summaryFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            summaries[start1] = { before, after, numSamples };
+
+        summaryFifo.finishedWrite(size1);
+    }
+
+    //============================= Message thread =============================
+
+    /** Reads up to maxNum summaries into dest, returns the number read. */
+    int popSummaries(Summary* dest, int maxNum)
+    {
+        int start1, size1, start2, size2;
+        summaryFifo.prepareToRead(maxNum, start1, size1, start2, size2);
+
+        std::copy(summaries.begin() + start1, summaries.begin() + start1 + size1, dest);
+        std::copy(summaries.begin() + start2, summaries.begin() + start2 + size2, dest + size1);
+
+        summaryFifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    AbstractFifo summaryFifo;
+    std::vector<Summary> summaries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalTap)
+};
@@ -23,7 +23,7 @@
 
 //==============================================================================
 
-Visualiser::Visualiser() : AudioVisualiserComponent(1)
+Visualiser::Visualiser() : AudioVisualiserComponent(0)
 {
     setNumChannels(1);
     setBufferSize(512);
@@ -33,16 +33,22 @@ Visualiser::Visualiser() : AudioVisualiserComponent(1)
 
 void Visualiser::setNumChannels(int numChannels)
 {
+    channelsBottom.clear();
     channelsTop.clear();
 
-    for (int i = 0; i < numChannels; ++i)
+    for (int i = 0; i < numChannels; ++i) {
+        channelsBottom.add(new ChannelInfo2(*this, numSamplesTop));
         channelsTop.add(new ChannelInfo2(*this, numSamplesTop));
+    }
 }
 
 void Visualiser::setBufferSize(int newNumSamples)
 {
     numSamplesTop = newNumSamples;
 
+    for (auto* c : channelsBottom)
+        c->setBufferSize(newNumSamples);
+
     for (auto* c : channelsTop)
         c->setBufferSize(newNumSamples);
 
@@ -51,27 +57,22 @@ void Visualiser::setBufferSize(int newNumSamples)
 
 void Visualiser::clear()
 {
+    for (auto* c : channelsBottom)
+        c->clear();
+
     for (auto* c : channelsTop)
         c->clear();
 
     AudioVisualiserComponent::clear();
 }
 
-void Visualiser::pushBufferTop(const float** d, int numChannels, int num)
-{
-    numChannels = jmin(numChannels, channelsTop.size());
-
-    for (int i = 0; i < numChannels; ++i)
-        channelsTop.getUnchecked(i)->pushSamples(d[i], num);
-}
-
-void Visualiser::pushBuffer(const AudioBuffer<float>& bufferBottom, const AudioBuffer<float>& bufferTop)
+void Visualiser::pushSummary(Range<float> rangeBottom, Range<float> rangeTop, int num)
 {
-    pushBufferTop(bufferTop.getArrayOfReadPointers(),
-        bufferTop.getNumChannels(),
-        bufferTop.getNumSamples());
+    for (auto* c : channelsBottom)
+        c->pushRange(rangeBottom, num);
 
-    AudioVisualiserComponent::pushBuffer(bufferBottom);
+    for (auto* c : channelsTop)
+        c->pushRange(rangeTop, num);
 }
 
 void Visualiser::setSamplesPerBlock(int newSamplesPerPixel) noexcept
@@ -85,6 +86,7 @@ void Visualiser::setSamplesPerBlock(int newSamplesPerPixel) noexcept
 
 void Visualiser::setColours(Colour bk, Colour fg) noexcept
 {
+    waveformColour1 = fg;
     waveformColour2 = fg.darker(0.4);
 
     AudioVisualiserComponent::setColours(bk, fg);
@@ -98,6 +100,12 @@ void Visualiser::paint(Graphics& g)
     auto r = getLocalBounds().toFloat();
     auto channelHeight = r.getHeight();
 
+    g.setColour(waveformColour1);
+
+    for (auto* c : channelsBottom)
+        paintChannel(g, r.removeFromTop(channelHeight), c->levels.begin(), c->levels.size(), c->nextSample);
+
+    r = getLocalBounds().toFloat();
     g.setColour(waveformColour2);
 
     for (auto* c : channelsTop)
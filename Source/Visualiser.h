@@ -28,9 +28,10 @@
     An extension of the AudioVisualiserComponent class to support two waveforms
     drawn on top of each other.
     All methods necessary for drawing the waveform were overridden and extended
-    to replicate the work done by the base class for a second AudioBuffer.
-    The base methods are called by the overriding methods to draw the bottom 
-    waveform, while the overriding methods draw the top waveform.
+    to replicate the work done by the base class for two AudioBuffers.
+    Both waveforms are fed with summaries, i.e. the range of the signal over
+    a number of samples.
+    The base class only provides the timer, background and channel painting.
 */
 class Visualiser : public AudioVisualiserComponent
 {
@@ -40,8 +41,7 @@ public:
     void setNumChannels(int numChannels);
     void setBufferSize(int newNumSamples);
     void clear();
-    void pushBufferTop(const float** d, int numChannels, int num);
-    void pushBuffer(const AudioBuffer<float>& bufferBottom, const AudioBuffer<float>& bufferTop);
+    void pushSummary(Range<float> rangeBottom, Range<float> rangeTop, int num);
     void setSamplesPerBlock(int newSamplesPerPixel) noexcept;
 
     void setColours(Colour bk, Colour fg) noexcept;
@@ -63,26 +63,28 @@ private:
             subSample = 0;
         }
 
-        void pushSamples(const float* inputSamples, int num) noexcept
+        // The range covers num samples, it is merged into every level it overlaps
+        void pushRange(Range<float> range, int num) noexcept
         {
-            for (int i = 0; i < num; ++i)
-                pushSample(inputSamples[i]);
-        }
-
-        void pushSample(float newSample) noexcept
-        {
-            if (--subSample <= 0)
-            {
-                if (++nextSample == levels.size())
-                    nextSample = 0;
-
-                levels.getReference(nextSample) = value;
-                subSample = owner.getSamplesPerBlock();
-                value = Range<float>(newSample, newSample);
-            }
-            else
+            while (num > 0)
             {
-                value = value.getUnionWith(newSample);
+                if (subSample <= 0)
+                {
+                    if (++nextSample == levels.size())
+                        nextSample = 0;
+
+                    levels.getReference(nextSample) = value;
+                    subSample = owner.getSamplesPerBlock();
+                    value = range;
+                }
+                else
+                {
+                    value = value.getUnionWith(range);
+                }
+
+                const int used = jmin(num, subSample.load());
+                subSample -= used;
+                num -= used;
             }
         }
 
@@ -103,7 +105,7 @@ private:
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelInfo2)
     };
 
-    OwnedArray<ChannelInfo2> channelsTop;
+    OwnedArray<ChannelInfo2> channelsBottom, channelsTop;
     int numSamplesTop, inputSamplesPerBlockTop;
-    Colour waveformColour2;
+    Colour waveformColour1, waveformColour2;
 };
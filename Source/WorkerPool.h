@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+//==============================================================================
+/**
+    Real-time threads that help the audio thread with independent jobs of one
+    block, like the lane groups of the unlinked kernels.
+
+    The audio thread publishes a job by bumping a generation counter, runs its
+    share of the indices itself and then spins until every worker has reported
+    the generation as finished. Nothing is allocated. Idle workers spin for a
+    while after each job and then park on a WaitableEvent. Signalling the event
+    takes its mutex. The audio thread only signals the workers that parked, that
+    is all of them when the blocks are further apart than the spin.
+*/
+class WorkerPool
+{
+public:
+    WorkerPool() = default;
+    ~WorkerPool() { release(); }
+
+    /**
+        Starts numWorkers threads with real-time priority, pinned to the cores
+        after the first one where the platform allows it. Stops the previous
+        workers, call from prepareToPlay.
+    */
+    void prepare(int numWorkers)
+    {
+        release();
+
+        const int numCpus = SystemStats::getNumCpus();
+        for (int index = 0; index < numWorkers; ++index) {
+            Worker* worker = workers.add(new Worker(*this, index));
+            if (numCpus > 1 && numCpus <= 32)
+                worker->setAffinityMask(1u << ((index + 1) % numCpus));
+            worker->startThread(Thread::realtimeAudioPriority);
+        }
+    }
+
+    /** Stops the workers, run() then does all jobs on the calling thread. */
+    void release()
+    {
+        for (Worker* worker : workers) {
+            worker->signalThreadShouldExit();
+            worker->wake.signal();
+        }
+        for (Worker* worker : workers)
+            worker->stopThread(1000);
+
+        workers.clear();
+    }
+
+    int getNumWorkers() const { return workers.size(); }
+
+    /**
+        Calls job(index) for every index from 0 to numJobs - 1 and returns when all
+        calls are done. The calling thread takes every (numWorkers + 1)th index
+        starting at 0, worker w the ones starting at w + 1. Without workers or
+        with a single job everything runs inline.
+    */
+    template <typename Job>
+    void run(int numJobs, Job& job)
+    {
+        if (workers.isEmpty() || numJobs <= 1) {
+            for (int index = 0; index < numJobs; ++index)
+                job(index);
+            return;
+        }
+
+        function = [](void* context, int index) { (*static_cast<Job*>(context))(index); };
+        context = &job;
+        totalJobs = numJobs;
+
+        // Publishes the job, a worker that parked before it could see it is woken up
+        const int current = generation.fetch_add(1) + 1;
+        for (Worker* worker : workers)
+            if (worker->parked.load())
+                worker->wake.signal();
+
+        runJobs(0);
+
+        for (Worker* worker : workers)
+            while (worker->finished.load(std::memory_order_acquire) != current)
+                pause();
+    }
+
+private:
+    //==============================================================================
+    enum { spinsBeforeParking = 1 << 14 };
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(WorkerPool& owner, int workerIndex)
+            : Thread("Compressor Worker " + String(workerIndex + 1)), pool(owner), index(workerIndex),
+              finished(owner.generation.load())
+        {
+        }
+
+        void run() override
+        {
+            // Starts from the generation at construction, a job published before the thread ran isn't missed
+            int seen = finished.load(std::memory_order_acquire);
+
+            while (!threadShouldExit()) {
+                const int current = waitForJob(seen);
+                if (current == seen)
+                    return;
+
+                pool.runJobs(index + 1);
+                finished.store(current, std::memory_order_release);
+                seen = current;
+            }
+        }
+
+        /** Spins and then parks until the generation moves on, returns seen if the thread should exit. */
+        int waitForJob(int seen)
+        {
+            for (int spins = 0;; ++spins) {
+                const int current = pool.generation.load(std::memory_order_acquire);
+                if (current != seen)
+                    return current;
+                if (threadShouldExit())
+                    return seen;
+
+                if (spins < spinsBeforeParking) {
+                    pause();
+                    continue;
+                }
+
+                // parked and generation are both sequentially consistent, so either this thread
+                // sees the new generation or the audio thread sees it parked and signals it
+                parked.store(true);
+                if (pool.generation.load() == seen && !threadShouldExit())
+                    wake.wait();
+                parked.store(false);
+                spins = 0;
+            }
+        }
+
+        WorkerPool& pool;
+        const int index;
+        WaitableEvent wake;
+        std::atomic<bool> parked{ false };
+        std::atomic<int> finished;
+    };
+
+    void runJobs(int participant)
+    {
+        const int numParticipants = workers.size() + 1;
+        for (int index = participant; index < totalJobs; index += numParticipants)
+            function(context, index);
+    }
+
+    static void pause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #endif
+    }
+
+    OwnedArray<Worker> workers;
+    std::atomic<int> generation{ 0 };
+
+    // Written by the audio thread before the generation is bumped, read by the workers after
+    void (*function)(void*, int) = nullptr;
+    void* context = nullptr;
+    int totalJobs = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WorkerPool)
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include <cmath>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "../Source/CompressorBank.h"
+#include "../Source/GainCurveTable.h"
+
+//==============================================================================
+/**
+    Compares every compressor of a CompressorBank with a scalar compressor that
+    uses libm like the scalar path of the plugin, for bank sizes that leave
+    padding lanes in the last lane group. Every compressor gets its own
+    parameters and its own level.
+*/
+class CompressorBankTests  : public UnitTest
+{
+public:
+    CompressorBankTests() : UnitTest("CompressorBank", "CKPA") {}
+
+    void runTest() override
+    {
+        for (int numCompressors : { 1, 5, 17, 37 }) {
+            beginTest(String(numCompressors) + " compressors");
+            expectMatchesScalar(numCompressors);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int numSamples = 9000;
+
+    static CompressorBank::Parameters makeParameters(int index)
+    {
+        CompressorBank::Parameters parameters;
+        parameters.threshold = -30.0f + (float) index;
+        parameters.ratio = 1.0f + (float) (index % 9);
+        parameters.knee = (float) (index % 3) * 6.0f;
+        parameters.attack = 0.001f * (float) (1 + index % 5);
+        parameters.release = 0.05f + 0.01f * (float) index;
+        parameters.makeupGain = (float) (index % 4) - 1.5f;
+        return parameters;
+    }
+
+    /**
+        Runs the lane groups one by one, the last one first, in two calls of
+        uneven length so a chunk is split. The gain of every sample has to stay
+        within the documented FastMath errors of the scalar gain.
+    */
+    void expectMatchesScalar(int numCompressors)
+    {
+        Random random(numCompressors);
+        std::vector<std::vector<float>> inputs((size_t) numCompressors, std::vector<float>(numSamples));
+        std::vector<std::vector<float>> outputs = inputs;
+
+        CompressorBank bank;
+        bank.prepare(sampleRate, numCompressors);
+
+        for (int c = 0; c < numCompressors; ++c) {
+            const float amplitude = 0.05f + 0.9f * (float) (c % 7) / 6.0f;
+            for (int i = 0; i < numSamples; ++i)
+                inputs[(size_t) c][(size_t) i] = amplitude * (2.0f * random.nextFloat() - 1.0f) * (i % 2000 < 1000 ? 1.0f : 0.05f);
+
+            bank.setParameters(c, makeParameters(c));
+        }
+
+        const int split = 1000 + 37;
+        for (int start : { 0, split }) {
+            std::vector<const float*> in;
+            std::vector<float*> out;
+            for (int c = 0; c < numCompressors; ++c) {
+                in.push_back(inputs[(size_t) c].data() + start);
+                out.push_back(outputs[(size_t) c].data() + start);
+            }
+
+            const int num = (start == 0) ? split : numSamples - split;
+            for (int laneGroup = bank.getNumLaneGroups(); --laneGroup >= 0;)
+                bank.processLaneGroup(laneGroup, in.data(), out.data(), num);
+        }
+
+        float maxError = 0.0f, maxEnvelopeError = 0.0f;
+
+        for (int c = 0; c < numCompressors; ++c) {
+            const std::vector<float>& input = inputs[(size_t) c];
+            const std::vector<float>& output = outputs[(size_t) c];
+            const CompressorBank::Parameters parameters = makeParameters(c);
+            const double alphaA = std::exp(-1.0 / (parameters.attack * sampleRate));
+            const double alphaR = std::exp(-1.0 / (parameters.release * sampleRate));
+            double ylPrev = 0.0;
+
+            for (int i = 0; i < numSamples; ++i) {
+                const float level = input[(size_t) i] * input[(size_t) i];
+                const float xg = (level <= 1e-6f) ? -60.0f : 10.0f * std::log10(level);
+                const float xl = GainCurveTable::computeReduction(xg, parameters.threshold, parameters.ratio,
+                                                                  parameters.knee);
+                const double alpha = (xl > ylPrev) ? alphaA : alphaR;
+                ylPrev = alpha * ylPrev + (1.0 - alpha) * xl;
+
+                const float gainDb = parameters.makeupGain - (float) ylPrev;
+                if (std::abs(input[(size_t) i]) > 1e-6f)
+                    maxError = jmax(maxError, std::abs(Decibels::gainToDecibels(output[(size_t) i] / input[(size_t) i]) - gainDb));
+            }
+
+            maxEnvelopeError = jmax(maxEnvelopeError, std::abs(bank.getGainReduction(c) - (float) ylPrev));
+        }
+
+        logMessage("Maximum gain error " + String(maxError, 5) + " dB, envelope error " + String(maxEnvelopeError, 5) + " dB");
+        expectLessThan(maxError, 0.005f);
+        expectLessThan(maxEnvelopeError, 0.005f);
+    }
+};
+
+static CompressorBankTests compressorBankTests;
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include <cmath>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "../Source/CompressorKernel.h"
+
+//==============================================================================
+/**
+    Compares the control gain of the control rate path with the per sample path
+    of the kernel, on decaying noise bursts over a 220 Hz tone at 48 kHz with
+    a threshold of -20 dB, a ratio of 4:1 and a release of 300 ms.
+*/
+class ControlRateTests  : public UnitTest
+{
+public:
+    ControlRateTests() : UnitTest("Control Rate", "CKPA") {}
+
+    void runTest() override
+    {
+        std::vector<float> input(4 * (int) sampleRate);
+        Random random(1);
+
+        for (int i = 0; i < (int) input.size(); ++i) {
+            const float decay = std::exp(-(float) (i % 12000) / 2400.0f);
+            input[i] = (2.0f * random.nextFloat() - 1.0f) * 0.4f * decay
+                       + 0.2f * std::sin(MathConstants<float>::twoPi * 220.0f * (float) i / (float) sampleRate);
+        }
+
+        // Maximum and RMS error in dB per attack time, for intervals of 8, 16 and 32 samples
+        const struct { float attackMs; float maxErrorDb[3]; float rmsErrorDb[3]; } limits[] = {
+            { 0.5f, { 0.5f, 0.8f, 1.2f }, { 0.01f, 0.015f, 0.025f } },
+            { 2.0f, { 0.2f, 0.25f, 0.3f }, { 0.005f, 0.007f, 0.01f } },
+            { 10.0f, { 0.05f, 0.06f, 0.07f }, { 0.002f, 0.003f, 0.004f } }
+        };
+        const int intervals[] = { 8, 16, 32 };
+
+        for (const auto& limit : limits) {
+            for (int k = 0; k < 3; ++k) {
+                beginTest("Attack " + String(limit.attackMs, 1) + " ms, interval " + String(intervals[k]));
+
+                const ConstantCoefficients coefficients{ std::exp(-1.0f / (limit.attackMs * 0.001f * (float) sampleRate)),
+                                                         std::exp(-1.0f / (0.3f * (float) sampleRate)) };
+                float maxError, rmsError;
+                measure(input, intervals[k], coefficients, maxError, rmsError);
+
+                logMessage("Maximum error " + String(maxError, 3) + " dB, RMS error " + String(rmsError, 4) + " dB");
+                expectLessThan(maxError, limit.maxErrorDb[k]);
+                expectLessThan(rmsError, limit.rmsErrorDb[k]);
+            }
+        }
+    }
+
+private:
+    typedef CompressorKernel<MixDownDetector, HardKneeCurve, BranchingSmoother, 1> Kernel;
+
+    static constexpr double sampleRate = 48000.0;
+
+    /** Runs both paths over the mono input and measures the difference of their control gains in dB. */
+    static void measure(const std::vector<float>& input, int interval, const ConstantCoefficients& coefficients,
+                        float& maxError, float& rmsError)
+    {
+        const HardKneeCurve curve{ -20.0f, 4.0f };
+        const float* channels[] = { input.data() };
+        const int num = (int) input.size();
+
+        CompressorState perSample, controlRate;
+        perSample.prepare(1);
+        controlRate.prepare(1);
+
+        float reference[Kernel::chunkSize], approximation[Kernel::chunkSize];
+        double sumOfSquares = 0.0;
+        maxError = 0.0f;
+
+        for (int start = 0; start < num; start += Kernel::chunkSize) {
+            const int length = jmin((int) Kernel::chunkSize, num - start);
+
+            MixDownDetector::process<1>(perSample, channels, 1, start, length, reference);
+            FloatVectorOperations::copy(approximation, reference, length);
+
+            Kernel::computeControl(perSample, curve, coefficients, 0.0f, 1, length, reference);
+            Kernel::computeControl(controlRate, curve, coefficients, 0.0f, interval, length, approximation);
+
+            for (int i = 0; i < length; ++i) {
+                const float error = std::abs(20.0f * std::log10(approximation[i] / reference[i]));
+                maxError = jmax(maxError, error);
+                sumOfSquares += error * error;
+            }
+        }
+
+        rmsError = (float) std::sqrt(sumOfSquares / num);
+    }
+};
+
+static ControlRateTests controlRateTests;
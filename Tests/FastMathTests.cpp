@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include <cmath>
+#include <cstring>
+
+#include <JuceHeader.h>
+#include "../Source/FastMath.h"
+
+//==============================================================================
+/**
+    Checks the error bounds documented in FastMath.h against libm in double,
+    for every normal float.
+*/
+class FastMathTests  : public UnitTest
+{
+public:
+    FastMathTests() : UnitTest("FastMath", "CKPA") {}
+
+    void runTest() override
+    {
+        beginTest("gainToDecibels over every normal float");
+        {
+            const double log2ToDecibels = 20.0 * std::log10(2.0);
+            double maxError = 0.0;
+
+            // Mantissa in the outer loop, so libm only runs once per mantissa
+            for (uint32 mantissa = 0; mantissa < smallestNormal; ++mantissa) {
+                const double mantissaLog2 = std::log2((double) fromBits(mantissa | 0x3f800000));
+
+                for (uint32 exponent = 1; exponent < 255; ++exponent) {
+                    const float gain = fromBits((exponent << 23) | mantissa);
+                    const double exact = ((double) exponent - 127.0 + mantissaLog2) * log2ToDecibels;
+                    maxError = jmax(maxError, std::abs(FastMath::gainToDecibels(gain, -1000.0f) - exact));
+                }
+            }
+
+            logMessage("Maximum error " + String(maxError, 6) + " dB");
+            expectLessThan(maxError, 0.0008);
+        }
+
+        beginTest("decibelsToGain over every normal float with a normal result");
+        {
+            // log2(10) / 20 times the range of exponents of normal floats
+            const double minDecibels = -126.0 / 0.166096405, maxDecibels = 127.99 / 0.166096405;
+            float decibels[chunkSize], gains[chunkSize];
+            double maxError = 0.0;
+
+            for (uint32 sign : { 0u, 0x80000000u }) {
+                for (uint32 first = smallestNormal; first < infinity; first += chunkSize) {
+                    int num = 0;
+
+                    for (uint32 bits = first; bits < jmin(first + (uint32) chunkSize, (uint32) infinity); ++bits) {
+                        const float value = fromBits(bits | sign);
+                        if (value > minDecibels && value < maxDecibels)
+                            decibels[num++] = value;
+                    }
+
+                    FastMath::decibelsToGain(decibels, gains, num);
+
+                    for (int i = 0; i < num; ++i)
+                        maxError = jmax(maxError, std::abs(20.0 * std::log10((double) gains[i]) - decibels[i]));
+                }
+            }
+
+            logMessage("Maximum error " + String(maxError, 6) + " dB");
+            expectLessThan(maxError, 0.0014);
+        }
+    }
+
+private:
+    enum : uint32 {
+        smallestNormal = 0x00800000,
+        infinity = 0x7f800000
+    };
+
+    static constexpr int chunkSize = 4096;
+
+    static float fromBits(uint32 bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+static FastMathTests fastMathTests;
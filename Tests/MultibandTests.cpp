@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    Code by cornzz and Philip Arms.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include <cmath>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "../Source/Multiband.h"
+
+//==============================================================================
+/**
+    Checks that the bands of the Linkwitz-Riley crossover sum back to the input
+    through the allpasses of all crossovers, for 3 and 4 bands at two rates.
+*/
+class MultibandTests  : public UnitTest
+{
+public:
+    MultibandTests() : UnitTest("Multiband", "CKPA") {}
+
+    void runTest() override
+    {
+        std::vector<float> input(96000);
+        Random random(3);
+        for (float& value : input)
+            value = 0.6f * random.nextFloat() - 0.3f;
+
+        const float fourBands[] = { 200.0f, 1000.0f, 5000.0f };
+        const float threeBands[] = { 300.0f, 3000.0f };
+
+        for (double sampleRate : { 44100.0, 96000.0 }) {
+            beginTest("Band sum nulls with 4 bands at " + String(sampleRate, 0) + " Hz");
+            expectNulls(sampleRate, 4, fourBands, input);
+
+            beginTest("Band sum nulls with 3 bands at " + String(sampleRate, 0) + " Hz");
+            expectNulls(sampleRate, 3, threeBands, input);
+        }
+    }
+
+private:
+    typedef LinkwitzRileyCrossover Crossover;
+
+    enum {
+        chunkSize = Crossover::chunkSize,
+        numLanes = Crossover::numLanes,
+        maxBands = Crossover::maxBands
+    };
+
+    /**
+        Splits the mono input and compares the sum of the bands with the input
+        through the allpasses. The largest difference has to stay 70 dB below the
+        peak of the input, what is left is the float rounding of the biquads.
+    */
+    void expectNulls(double sampleRate, int numBands, const float* frequencies, const std::vector<float>& input)
+    {
+        Crossover crossover;
+        crossover.prepare(sampleRate, 1);
+        crossover.setFrequencies(numBands, frequencies);
+
+        BiquadCoefficients allPass[maxBands - 1];
+        float allPassStates[maxBands - 1][2 * numLanes] = {};
+        for (int k = 0; k < numBands - 1; ++k)
+            allPass[k] = BiquadCoefficients::allPass(sampleRate, frequencies[k]);
+
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float reference[chunkSize * numLanes];
+        alignas(dsp::SIMDRegister<float>::SIMDRegisterSize) float bandData[maxBands][chunkSize * numLanes];
+        float* const bands[maxBands] = { bandData[0], bandData[1], bandData[2], bandData[3] };
+
+        const int num = (int) input.size();
+        float maxDifference = 0.0f, peak = 0.0f;
+
+        for (int start = 0; start < num; start += chunkSize) {
+            const int length = jmin((int) chunkSize, num - start);
+
+            FloatVectorOperations::clear(reference, length * numLanes);
+            for (int i = 0; i < length; ++i)
+                reference[i * numLanes] = input[start + i];
+
+            crossover.process(0, reference, length, bands);
+
+            for (int k = 0; k < numBands - 1; ++k)
+                Biquad::processLanes(allPass[k], allPassStates[k], reference, length);
+
+            for (int i = 0; i < length; ++i) {
+                float sum = 0.0f;
+                for (int band = 0; band < numBands; ++band)
+                    sum += bands[band][i * numLanes];
+
+                maxDifference = jmax(maxDifference, std::abs(sum - reference[i * numLanes]));
+                peak = jmax(peak, std::abs(input[start + i]));
+            }
+        }
+
+        const float nullDepth = Decibels::gainToDecibels(maxDifference / peak, -200.0f);
+        logMessage("Null depth " + String(nullDepth, 1) + " dB");
+        expectLessThan(nullDepth, -70.0f);
+    }
+};
+
+static MultibandTests multibandTests;